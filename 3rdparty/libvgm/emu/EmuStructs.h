@@ -26,6 +26,10 @@ typedef void (*DEVFUNC_PANALL)(void* info, const INT16* channelPanVal);
 typedef void (*DEVFUNC_SRCCB)(void* info, DEVCB_SRATE_CHG SmpRateChgCallback, void* paramPtr);
 typedef UINT8 (*DEVFUNC_LINKDEV)(void* info, UINT8 devID, const DEV_INFO* devInfLink);
 typedef void (*DEVFUNC_SETLOGCB)(void* info, DEVCB_LOG logFunc, void* userParam);
+// tapBufs[chn * 2 + 0/1] receive the left/right output of every channel in tapMask, scaled
+// like the regular output. The caller may redirect the pointers between Update calls.
+// returns 0 on success, non-zero if the current chip configuration can't be tapped
+typedef UINT8 (*DEVFUNC_CHNTAP)(void* info, UINT32 tapMask, DEV_SMPL** tapBufs);
 
 typedef UINT8 (*DEVFUNC_READ_A8D8)(void* info, UINT8 addr);
 typedef UINT16 (*DEVFUNC_READ_A8D16)(void* info, UINT8 addr);
@@ -58,6 +62,7 @@ typedef void (*DEVFUNC_WRITE_VOL_LR)(void* info, INT32 volL, INT32 volR);
 #define RWF_VOLUME_LR	0x86	// volume (left/right separately)
 #define RWF_CHN_MUTE	0x90	// set channel muting (DEVRW_VALUE = single channel, DEVRW_ALL = mask)
 #define RWF_CHN_PAN		0x92	// set channel panning (DEVRW_VALUE = single channel, DEVRW_ALL = array)
+#define RWF_CHN_TAP		0x94	// capture per-channel output (DEVRW_ALL = mask + buffer array)
 
 // register/memory DEVRW constants
 #define DEVRW_A8D8		0x11	//  8-bit address,  8-bit data
@@ -5,18 +5,27 @@
 #include <stdlib.h>	// for malloc/free
 
 #include "../stdtype.h"
+#include "../common_def.h"	// for INLINE, bool
 #include "EmuStructs.h"
 #include "Resampler.h"
+#include "cpu_simd.h"	// SIMD kernels are used for the Copy and Downsampling resamplers
 
 #define RESALGO_OLD			0x00
 #define RESALGO_LINEAR_UP	0x01
 #define RESALGO_COPY		0x02
 #define RESALGO_LINEAR_DOWN	0x03
 
+// number of output samples processed by the Downsampling resampler's SIMD kernels at once
+#define RESMPL_SIMD_BLOCK	0x100
+// shorter updates (e.g. between DAC stream writes) use the scalar code, which has less overhead
+#define RESMPL_SIMD_MIN		0x40
+
 static void Resmpl_Exec_Old(RESMPL_STATE* CAA, UINT32 length, WAVE_32BS* retSample);
 static void Resmpl_Exec_LinearUp(RESMPL_STATE* CAA, UINT32 length, WAVE_32BS* retSample);
 static void Resmpl_Exec_Copy(RESMPL_STATE* CAA, UINT32 length, WAVE_32BS* retSample);
+static void Resmpl_Exec_Copy_SIMD(RESMPL_STATE* CAA, UINT32 length, WAVE_32BS* retSample);
 static void Resmpl_Exec_LinearDown(RESMPL_STATE* CAA, UINT32 length, WAVE_32BS* retSample);
+static void Resmpl_Exec_LinearDown_SIMD(RESMPL_STATE* CAA, UINT32 length, WAVE_32BS* retSample);
 
 void Resmpl_DevConnect(RESMPL_STATE* CAA, const DEV_INFO* devInf)
 {
@@ -65,6 +74,7 @@ void Resmpl_Init(RESMPL_STATE* CAA)
 	CAA->smplBufs[0] = (DEV_SMPL*)malloc(CAA->smplBufSize * 2 * sizeof(DEV_SMPL));
 	CAA->smplBufs[1] = &CAA->smplBufs[0][CAA->smplBufSize];
 	
+	CAA->simd = SIMD_Detect();
 	CAA->smpP = 0x00;
 	CAA->smpLast = 0x00;
 	CAA->smpNext = 0x00;
@@ -310,9 +320,6 @@ static void Resmpl_Exec_Copy(RESMPL_STATE* CAA, UINT32 length, WAVE_32BS* retSam
 	return;
 }
 
-// TODO: The resample is not completely stable.
-//	Resampling tiny blocks (1 resulting sample) sometimes causes values to be off-by-one,
-//	compared to resampling large blocks.
 static void Resmpl_Exec_LinearDown(RESMPL_STATE* CAA, UINT32 length, WAVE_32BS* retSample)
 {
 	// RESALGO_LINEAR_DOWN: Linear Downsampling
@@ -347,13 +354,14 @@ static void Resmpl_Exec_LinearDown(RESMPL_STATE* CAA, UINT32 length, WAVE_32BS*
 	
 	InPosL = (SLINT)(CAA->smpP * ChipSmpRateFP / CAA->smpRateDst);
 	// I'm adding 1.0 to avoid negative indexes
-	InBase = FIXPNT_FACT + (UINT32)(InPosL - (SLINT)CAA->smpLast * FIXPNT_FACT);
-	InPosNext = InBase;
+	InBase = FIXPNT_FACT - (UINT32)((SLINT)CAA->smpLast * FIXPNT_FACT);
+	InPosNext = InBase + (UINT32)InPosL;
 	for (OutPos = 0; OutPos < length; OutPos ++)
 	{
-		//InPos = InBase + (UINT32)(OutPos * ChipSmpRateFP / CAA->smpRateDst);
+		// Round positions relative to the start of the song rather than the start of this call,
+		// so that the output doesn't depend on how rendering is split into calls.
 		InPos = InPosNext;
-		InPosNext = InBase + (UINT32)((OutPos+1) * ChipSmpRateFP / CAA->smpRateDst);
+		InPosNext = InBase + (UINT32)((CAA->smpP + OutPos + 1) * ChipSmpRateFP / CAA->smpRateDst);
 		
 		// first fractional Sample
 		SmpFrc = getnfraction(InPos);
@@ -410,6 +418,419 @@ static void Resmpl_Exec_LinearDown(RESMPL_STATE* CAA, UINT32 length, WAVE_32BS*
 	return;
 }
 
+// ---- SIMD kernels ----
+// The scalar resamplers above are the reference. Each kernel must give bit-identical output.
+
+// retSample[i] += {bufL[i] * volL, bufR[i] * volR}
+static void AddScaled_Scalar(WAVE_32BS* retSample, const DEV_SMPL* bufL, const DEV_SMPL* bufR,
+							INT32 volL, INT32 volR, UINT32 length)
+{
+	UINT32 OutPos;
+	
+	for (OutPos = 0; OutPos < length; OutPos ++)
+	{
+		retSample[OutPos].L += bufL[OutPos] * volL;
+		retSample[OutPos].R += bufR[OutPos] * volR;
+	}
+	
+	return;
+}
+
+// retSample[i] += {numL[i] / cnt[i], numR[i] / cnt[i]}
+static void DivAdd_Scalar(WAVE_32BS* retSample, const INT64* numL, const INT64* numR,
+						const INT32* cnt, UINT32 length)
+{
+	UINT32 OutPos;
+	
+	for (OutPos = 0; OutPos < length; OutPos ++)
+	{
+		retSample[OutPos].L += (INT32)(numL[OutPos] / cnt[OutPos]);
+		retSample[OutPos].R += (INT32)(numR[OutPos] / cnt[OutPos]);
+	}
+	
+	return;
+}
+
+// The DivAdd kernels divide in double precision, which is exact as long as the numerator
+// fits in DIVADD_RANGE and the divisor is at least FIXPNT_FACT:
+//	- Numerators below 2^51 convert to double exactly (using DIVADD_MAGIC).
+//	- If the quotient isn't an integer, it's at least 1/divisor away from the nearest integer,
+//	  which is more than the rounding error of the division. So truncation is exact.
+//	- The quotient fits into 32 bits (like the scalar code's INT32 cast).
+#define DIVADD_RANGE	((INT64)1 << (31 + FIXPNT_BITS))
+#define DIVADD_MAGIC	0x4338000000000000LL	// 1.5 * 2^52 as double
+
+#if defined(VGM_SIMD_SSE2)
+INLINE __m128i MulLo32_SSE2(__m128i a, __m128i b)
+{
+	// SSE2 has no 32-bit multiplication with 32-bit result, so multiply even/odd lanes
+	// into 64-bit results and keep the lower halves.
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+							_mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static void AddScaled_SSE2(WAVE_32BS* retSample, const DEV_SMPL* bufL, const DEV_SMPL* bufR,
+						INT32 volL, INT32 volR, UINT32 length)
+{
+	const __m128i vol = _mm_set_epi32(volR, volL, volR, volL);
+	__m128i* out;
+	__m128i smplL;
+	__m128i smplR;
+	UINT32 OutPos;
+	
+	for (OutPos = 0; OutPos + 4 <= length; OutPos += 4)
+	{
+		out = (__m128i*)&retSample[OutPos];
+		smplL = _mm_loadu_si128((const __m128i*)&bufL[OutPos]);
+		smplR = _mm_loadu_si128((const __m128i*)&bufR[OutPos]);
+		_mm_storeu_si128(&out[0], _mm_add_epi32(_mm_loadu_si128(&out[0]),
+			MulLo32_SSE2(_mm_unpacklo_epi32(smplL, smplR), vol)));
+		_mm_storeu_si128(&out[1], _mm_add_epi32(_mm_loadu_si128(&out[1]),
+			MulLo32_SSE2(_mm_unpackhi_epi32(smplL, smplR), vol)));
+	}
+	AddScaled_Scalar(&retSample[OutPos], &bufL[OutPos], &bufR[OutPos], volL, volR, length - OutPos);
+	
+	return;
+}
+
+static void DivAdd_SSE2(WAVE_32BS* retSample, const INT64* numL, const INT64* numR,
+						const INT32* cnt, UINT32 length)
+{
+	const __m128i magicI = _mm_set1_epi64x(DIVADD_MAGIC);
+	const __m128d magicD = _mm_castsi128_pd(magicI);
+	__m128i* out;
+	__m128d div;
+	__m128i quotL;
+	__m128i quotR;
+	UINT32 OutPos;
+	
+	for (OutPos = 0; OutPos + 2 <= length; OutPos += 2)
+	{
+		out = (__m128i*)&retSample[OutPos];
+		div = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)&cnt[OutPos]));
+		quotL = _mm_cvttpd_epi32(_mm_div_pd(_mm_sub_pd(_mm_castsi128_pd(_mm_add_epi64(
+			_mm_loadu_si128((const __m128i*)&numL[OutPos]), magicI)), magicD), div));
+		quotR = _mm_cvttpd_epi32(_mm_div_pd(_mm_sub_pd(_mm_castsi128_pd(_mm_add_epi64(
+			_mm_loadu_si128((const __m128i*)&numR[OutPos]), magicI)), magicD), div));
+		_mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), _mm_unpacklo_epi32(quotL, quotR)));
+	}
+	DivAdd_Scalar(&retSample[OutPos], &numL[OutPos], &numR[OutPos], &cnt[OutPos], length - OutPos);
+	
+	return;
+}
+#endif	// VGM_SIMD_SSE2
+
+#if defined(VGM_SIMD_AVX2)
+__attribute__((target("avx2")))
+static void AddScaled_AVX2(WAVE_32BS* retSample, const DEV_SMPL* bufL, const DEV_SMPL* bufR,
+						INT32 volL, INT32 volR, UINT32 length)
+{
+	const __m256i vol = _mm256_set_epi32(volR, volL, volR, volL, volR, volL, volR, volL);
+	__m256i* out;
+	__m256i smplL;
+	__m256i smplR;
+	__m256i smplLo;
+	__m256i smplHi;
+	UINT32 OutPos;
+	
+	for (OutPos = 0; OutPos + 8 <= length; OutPos += 8)
+	{
+		out = (__m256i*)&retSample[OutPos];
+		smplL = _mm256_loadu_si256((const __m256i*)&bufL[OutPos]);
+		smplR = _mm256_loadu_si256((const __m256i*)&bufR[OutPos]);
+		// unpack works within 128-bit lanes: Lo = samples 0, 1, 4, 5 and Hi = samples 2, 3, 6, 7
+		smplLo = _mm256_unpacklo_epi32(smplL, smplR);
+		smplHi = _mm256_unpackhi_epi32(smplL, smplR);
+		_mm256_storeu_si256(&out[0], _mm256_add_epi32(_mm256_loadu_si256(&out[0]),
+			_mm256_mullo_epi32(_mm256_permute2x128_si256(smplLo, smplHi, 0x20), vol)));
+		_mm256_storeu_si256(&out[1], _mm256_add_epi32(_mm256_loadu_si256(&out[1]),
+			_mm256_mullo_epi32(_mm256_permute2x128_si256(smplLo, smplHi, 0x31), vol)));
+	}
+	AddScaled_SSE2(&retSample[OutPos], &bufL[OutPos], &bufR[OutPos], volL, volR, length - OutPos);
+	
+	return;
+}
+
+__attribute__((target("avx2")))
+static void DivAdd_AVX2(WAVE_32BS* retSample, const INT64* numL, const INT64* numR,
+						const INT32* cnt, UINT32 length)
+{
+	const __m256i magicI = _mm256_set1_epi64x(DIVADD_MAGIC);
+	const __m256d magicD = _mm256_castsi256_pd(magicI);
+	__m128i* out;
+	__m256d div;
+	__m128i quotL;
+	__m128i quotR;
+	UINT32 OutPos;
+	
+	for (OutPos = 0; OutPos + 4 <= length; OutPos += 4)
+	{
+		out = (__m128i*)&retSample[OutPos];
+		div = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)&cnt[OutPos]));
+		quotL = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(
+			_mm256_loadu_si256((const __m256i*)&numL[OutPos]), magicI)), magicD), div));
+		quotR = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(
+			_mm256_loadu_si256((const __m256i*)&numR[OutPos]), magicI)), magicD), div));
+		_mm_storeu_si128(&out[0], _mm_add_epi32(_mm_loadu_si128(&out[0]), _mm_unpacklo_epi32(quotL, quotR)));
+		_mm_storeu_si128(&out[1], _mm_add_epi32(_mm_loadu_si128(&out[1]), _mm_unpackhi_epi32(quotL, quotR)));
+	}
+	DivAdd_SSE2(&retSample[OutPos], &numL[OutPos], &numR[OutPos], &cnt[OutPos], length - OutPos);
+	
+	return;
+}
+#endif	// VGM_SIMD_AVX2
+
+#if defined(VGM_SIMD_NEON)
+static void AddScaled_NEON(WAVE_32BS* retSample, const DEV_SMPL* bufL, const DEV_SMPL* bufR,
+						INT32 volL, INT32 volR, UINT32 length)
+{
+	int32x4x2_t out;
+	UINT32 OutPos;
+	
+	for (OutPos = 0; OutPos + 4 <= length; OutPos += 4)
+	{
+		// vld2q/vst2q (de)interleave L/R
+		out = vld2q_s32((const int32_t*)&retSample[OutPos]);
+		out.val[0] = vmlaq_n_s32(out.val[0], vld1q_s32((const int32_t*)&bufL[OutPos]), volL);
+		out.val[1] = vmlaq_n_s32(out.val[1], vld1q_s32((const int32_t*)&bufR[OutPos]), volR);
+		vst2q_s32((int32_t*)&retSample[OutPos], out);
+	}
+	AddScaled_Scalar(&retSample[OutPos], &bufL[OutPos], &bufR[OutPos], volL, volR, length - OutPos);
+	
+	return;
+}
+
+static void DivAdd_NEON(WAVE_32BS* retSample, const INT64* numL, const INT64* numR,
+						const INT32* cnt, UINT32 length)
+{
+	int32x2x2_t out;
+	float64x2_t div;
+	UINT32 OutPos;
+	
+	for (OutPos = 0; OutPos + 2 <= length; OutPos += 2)
+	{
+		out = vld2_s32((const int32_t*)&retSample[OutPos]);
+		div = vcvtq_f64_s64(vmovl_s32(vld1_s32((const int32_t*)&cnt[OutPos])));
+		out.val[0] = vadd_s32(out.val[0], vmovn_s64(vcvtq_s64_f64(vdivq_f64(
+			vcvtq_f64_s64(vld1q_s64((const int64_t*)&numL[OutPos])), div))));
+		out.val[1] = vadd_s32(out.val[1], vmovn_s64(vcvtq_s64_f64(vdivq_f64(
+			vcvtq_f64_s64(vld1q_s64((const int64_t*)&numR[OutPos])), div))));
+		vst2_s32((int32_t*)&retSample[OutPos], out);
+	}
+	DivAdd_Scalar(&retSample[OutPos], &numL[OutPos], &numR[OutPos], &cnt[OutPos], length - OutPos);
+	
+	return;
+}
+#endif	// VGM_SIMD_NEON
+
+static void AddScaled(UINT8 simd, WAVE_32BS* retSample, const DEV_SMPL* bufL, const DEV_SMPL* bufR,
+					INT32 volL, INT32 volR, UINT32 length)
+{
+	switch(simd)
+	{
+#if defined(VGM_SIMD_AVX2)
+	case SIMD_TYPE_AVX2:
+		AddScaled_AVX2(retSample, bufL, bufR, volL, volR, length);
+		break;
+#endif
+#if defined(VGM_SIMD_SSE2)
+	case SIMD_TYPE_SSE2:
+		AddScaled_SSE2(retSample, bufL, bufR, volL, volR, length);
+		break;
+#endif
+#if defined(VGM_SIMD_NEON)
+	case SIMD_TYPE_NEON:
+		AddScaled_NEON(retSample, bufL, bufR, volL, volR, length);
+		break;
+#endif
+	default:
+		AddScaled_Scalar(retSample, bufL, bufR, volL, volR, length);
+		break;
+	}
+	
+	return;
+}
+
+static void DivAdd(UINT8 simd, WAVE_32BS* retSample, const INT64* numL, const INT64* numR,
+					const INT32* cnt, UINT32 length)
+{
+	switch(simd)
+	{
+#if defined(VGM_SIMD_AVX2)
+	case SIMD_TYPE_AVX2:
+		DivAdd_AVX2(retSample, numL, numR, cnt, length);
+		break;
+#endif
+#if defined(VGM_SIMD_SSE2)
+	case SIMD_TYPE_SSE2:
+		DivAdd_SSE2(retSample, numL, numR, cnt, length);
+		break;
+#endif
+#if defined(VGM_SIMD_NEON)
+	case SIMD_TYPE_NEON:
+		DivAdd_NEON(retSample, numL, numR, cnt, length);
+		break;
+#endif
+	default:
+		DivAdd_Scalar(retSample, numL, numR, cnt, length);
+		break;
+	}
+	
+	return;
+}
+
+// same as Resmpl_Exec_Copy
+static void Resmpl_Exec_Copy_SIMD(RESMPL_STATE* CAA, UINT32 length, WAVE_32BS* retSample)
+{
+	CAA->smpNext = CAA->smpP * CAA->smpRateSrc / CAA->smpRateDst;
+	CAA->StreamUpdate(CAA->su_DataPtr, length, CAA->smplBufs);
+	
+	AddScaled(CAA->simd, retSample, CAA->smplBufs[0], CAA->smplBufs[1], CAA->volumeL, CAA->volumeR, length);
+	CAA->smpP += length;
+	CAA->smpLast = CAA->smpNext;
+	
+	if (CAA->smpLast >= CAA->smpRateSrc)
+	{
+		CAA->smpLast -= CAA->smpRateSrc;
+		CAA->smpNext -= CAA->smpRateSrc;
+		CAA->smpP -= CAA->smpRateDst;
+	}
+	
+	return;
+}
+
+// Same as Resmpl_Exec_LinearDown, but sums up each output sample into a block of numerators,
+// and divides the whole block at once.
+static void Resmpl_Exec_LinearDown_SIMD(RESMPL_STATE* CAA, UINT32 length, WAVE_32BS* retSample)
+{
+	DEV_SMPL* CurBufL;
+	DEV_SMPL* CurBufR;
+	DEV_SMPL* StreamPnt[0x02];
+	UINT32 InBase;
+	UINT32 InPos;
+	UINT32 InPosNext;
+	UINT32 OutPos;
+	UINT32 BlkPos;
+	UINT32 BlkLen;
+	UINT32 SmpFrc;	// Sample Fraction
+	UINT32 InPre;
+	UINT32 InNow;
+	SLINT InPosL;
+	INT64 TempSmpL;
+	INT64 TempSmpR;
+	INT32 SmpCnt;	// must be signed, else I'm getting calculation errors
+	UINT64 ChipSmpRateFP;
+	UINT64 PosQuot;	// (smpP + OutPos + 1) * ChipSmpRateFP / smpRateDst, updated without dividing
+	UINT64 PosRem;
+	UINT64 StepQuot;
+	UINT64 StepRem;
+	INT64 NumL[RESMPL_SIMD_BLOCK];
+	INT64 NumR[RESMPL_SIMD_BLOCK];
+	INT32 Cnt[RESMPL_SIMD_BLOCK];
+	bool OutOfRange;
+	
+	CurBufL = CAA->smplBufs[0];
+	CurBufR = CAA->smplBufs[1];
+	
+	ChipSmpRateFP = FIXPNT_FACT * CAA->smpRateSrc;
+	InPosL = (SLINT)((CAA->smpP + length) * ChipSmpRateFP / CAA->smpRateDst);
+	CAA->smpNext = (UINT32)fp2i_ceil(InPosL);
+	
+	CurBufL[0] = CAA->lSmpl.L;
+	CurBufR[0] = CAA->lSmpl.R;
+	StreamPnt[0] = &CurBufL[1];
+	StreamPnt[1] = &CurBufR[1];
+	CAA->StreamUpdate(CAA->su_DataPtr, CAA->smpNext - CAA->smpLast, StreamPnt);
+	
+	InPosL = (SLINT)(CAA->smpP * ChipSmpRateFP / CAA->smpRateDst);
+	// I'm adding 1.0 to avoid negative indexes
+	InBase = FIXPNT_FACT - (UINT32)((SLINT)CAA->smpLast * FIXPNT_FACT);
+	InPosNext = InBase + (UINT32)InPosL;
+	PosQuot = (CAA->smpP + 1) * ChipSmpRateFP / CAA->smpRateDst;
+	PosRem = (CAA->smpP + 1) * ChipSmpRateFP % CAA->smpRateDst;
+	StepQuot = ChipSmpRateFP / CAA->smpRateDst;
+	StepRem = ChipSmpRateFP % CAA->smpRateDst;
+	InPre = 0;
+	for (BlkPos = 0; BlkPos < length; BlkPos += BlkLen)
+	{
+		BlkLen = length - BlkPos;
+		if (BlkLen > RESMPL_SIMD_BLOCK)
+			BlkLen = RESMPL_SIMD_BLOCK;
+		
+		OutOfRange = false;
+		for (OutPos = 0; OutPos < BlkLen; OutPos ++)
+		{
+			InPos = InPosNext;
+			InPosNext = InBase + (UINT32)PosQuot;
+			PosQuot += StepQuot;
+			PosRem += StepRem;
+			if (PosRem >= CAA->smpRateDst)
+			{
+				PosRem -= CAA->smpRateDst;
+				PosQuot ++;
+			}
+			
+			// first fractional Sample
+			SmpFrc = getnfraction(InPos);
+			if (SmpFrc)
+			{
+				InPre = fp2i_floor(InPos);
+				TempSmpL = (INT64)CurBufL[InPre] * SmpFrc;
+				TempSmpR = (INT64)CurBufR[InPre] * SmpFrc;
+			}
+			else
+			{
+				TempSmpL = TempSmpR = 0;
+			}
+			SmpCnt = SmpFrc;
+			
+			// last fractional Sample
+			SmpFrc = getfraction(InPosNext);
+			InPre = fp2i_floor(InPosNext);
+			if (SmpFrc)
+			{
+				TempSmpL += (INT64)CurBufL[InPre] * SmpFrc;
+				TempSmpR += (INT64)CurBufR[InPre] * SmpFrc;
+				SmpCnt += SmpFrc;
+			}
+			
+			// whole Samples in between
+			InNow = fp2i_ceil(InPos);
+			SmpCnt += (InPre - InNow) * FIXPNT_FACT;	// this is faster
+			while(InNow < InPre)
+			{
+				TempSmpL += (INT64)CurBufL[InNow] * FIXPNT_FACT;
+				TempSmpR += (INT64)CurBufR[InNow] * FIXPNT_FACT;
+				InNow ++;
+			}
+			
+			NumL[OutPos] = TempSmpL * CAA->volumeL;
+			NumR[OutPos] = TempSmpR * CAA->volumeR;
+			Cnt[OutPos] = SmpCnt;
+			OutOfRange |= (UINT64)(NumL[OutPos] + DIVADD_RANGE) >= (UINT64)(2 * DIVADD_RANGE);
+			OutOfRange |= (UINT64)(NumR[OutPos] + DIVADD_RANGE) >= (UINT64)(2 * DIVADD_RANGE);
+		}
+		
+		DivAdd(OutOfRange ? SIMD_TYPE_NONE : CAA->simd, &retSample[BlkPos], NumL, NumR, Cnt, BlkLen);
+	}
+	
+	CAA->lSmpl.L = CurBufL[InPre];
+	CAA->lSmpl.R = CurBufR[InPre];
+	CAA->smpP += length;
+	CAA->smpLast = CAA->smpNext;
+	
+	if (CAA->smpLast >= CAA->smpRateSrc)
+	{
+		CAA->smpLast -= CAA->smpRateSrc;
+		CAA->smpNext -= CAA->smpRateSrc;
+		CAA->smpP -= CAA->smpRateDst;
+	}
+	
+	return;
+}
+
 void Resmpl_Execute(RESMPL_STATE* CAA, UINT32 smplCount, WAVE_32BS* smplBuffer)
 {
 	if (! smplCount)
@@ -424,10 +845,16 @@ void Resmpl_Execute(RESMPL_STATE* CAA, UINT32 smplCount, WAVE_32BS* smplBuffer)
 		Resmpl_Exec_LinearUp(CAA, smplCount, smplBuffer);
 		break;
 	case RESALGO_COPY:	// Copying
-		Resmpl_Exec_Copy(CAA, smplCount, smplBuffer);
+		if (CAA->simd != SIMD_TYPE_NONE && smplCount >= RESMPL_SIMD_MIN)
+			Resmpl_Exec_Copy_SIMD(CAA, smplCount, smplBuffer);
+		else
+			Resmpl_Exec_Copy(CAA, smplCount, smplBuffer);
 		break;
 	case RESALGO_LINEAR_DOWN:	// Downsampling
-		Resmpl_Exec_LinearDown(CAA, smplCount, smplBuffer);
+		if (CAA->simd != SIMD_TYPE_NONE && smplCount >= RESMPL_SIMD_MIN)
+			Resmpl_Exec_LinearDown_SIMD(CAA, smplCount, smplBuffer);
+		else
+			Resmpl_Exec_LinearDown(CAA, smplCount, smplBuffer);
 		break;
 	default:
 		CAA->smpP += CAA->smpRateDst;
@@ -37,6 +37,7 @@ typedef struct _resampling_state
 	WAVE_32BS nSmpl;	// Next Sample
 	UINT32 smplBufSize;
 	DEV_SMPL* smplBufs[2];
+	UINT8 simd;		// SIMD kernels used by the Copy and Downsampling resamplers (set by Resmpl_Init)
 } RESMPL_STATE;
 
 // ---- resampler helper functions (for quick/comfortable initialization) ----
@@ -32,6 +32,7 @@ static DEVDEF_RWFUNC devFunc_MAME[] =
 	{RWF_REGISTER | RWF_WRITE, DEVRW_A8D8, 0, ym2612_write},
 	{RWF_REGISTER | RWF_READ, DEVRW_A8D8, 0, ym2612_read},
 	{RWF_CHN_MUTE | RWF_WRITE, DEVRW_ALL, 0, ym2612_set_mute_mask},
+	{RWF_CHN_TAP | RWF_WRITE, DEVRW_ALL, 0, ym2612_set_chn_taps},
 	{0x00, 0x00, 0, NULL}
 };
 static DEV_DEF devDef_MAME =
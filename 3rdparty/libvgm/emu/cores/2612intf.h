@@ -20,6 +20,9 @@
 #define OPT_YM2612_TYPE_OPN2		0x00	// [Nuked OPN2] emulate YM2612
 #define OPT_YM2612_TYPE_OPN2C_ASIC	0x10	// [Nuked OPN2] emulate ASIC YM3438
 #define OPT_YM2612_TYPE_OPN2C_DISC	0x20	// [Nuked OPN2] emulate Discrete YM3438
+#define OPT_YM2612_SKIP_MUTED_EG	0x40	// [GPGX core] don't update envelopes of muted channels
+											// speeds up rendering single channels, but muted channels
+											// resume with stale envelopes when unmuted (default: disabled)
 #define OPT_YM2612_LEGACY_MODE		0x80	// [GPGX core] simulate behaviour of older emulation cores
 											// not recommended, but required for playing GYM files
 											// (default: disabled)
@@ -4358,8 +4358,61 @@ typedef struct
 	UINT8       WaveOutMode;
 	INT32       WaveL;
 	INT32       WaveR;
+
+	UINT8       SkipMutedEG;        /* don't update envelopes of muted channels */
+
+	/* per-channel output taps (FM 1-6, DAC) */
+	UINT32      TapMask;
+	DEV_SMPL**  TapBufs;
 } YM2612;
 
+/* write the output of each tapped channel, as it would sound with all other channels muted */
+INLINE void ym2612_write_taps(YM2612 *F2612, UINT32 smpl, INT32 lt, INT32 rt)
+{
+	FM_OPN *OPN = &F2612->OPN;
+	INT32 *out_fm = OPN->out_fm;
+	INT32 tapL[7];
+	INT32 tapR[7];
+	UINT8 CurChn;
+
+	if (! F2612->dac_test)
+	{
+		for (CurChn = 0; CurChn < 6; CurChn ++)
+		{
+			tapL[CurChn] = out_fm[CurChn] & OPN->pan[CurChn * 2 + 0];
+			tapR[CurChn] = out_fm[CurChn] & OPN->pan[CurChn * 2 + 1];
+		}
+		if (F2612->dacen)
+		{
+			/* channel 6 outputs the DAC instead of FM */
+			tapL[6] = tapL[5];
+			tapR[6] = tapR[5];
+			tapL[5] = tapR[5] = 0;
+		}
+		else
+		{
+			tapL[6] = tapR[6] = 0;
+		}
+	}
+	else
+	{
+		/* DAC test mode outputs the DAC on all channels */
+		for (CurChn = 0; CurChn < 6; CurChn ++)
+			tapL[CurChn] = tapR[CurChn] = 0;
+		tapL[6] = lt;
+		tapR[6] = rt;
+	}
+
+	for (CurChn = 0; CurChn < 7; CurChn ++)
+	{
+		if (F2612->TapMask & (1 << CurChn))
+		{
+			F2612->TapBufs[CurChn * 2 + 0][smpl] = tapL[CurChn];
+			F2612->TapBufs[CurChn * 2 + 1][smpl] = tapR[CurChn];
+		}
+	}
+}
+
 /* Generate samples for one of the YM2612s */
 void ym2612_update_one(void *chip, UINT32 length, DEV_SMPL **buffer)
 {
@@ -4371,6 +4424,8 @@ void ym2612_update_one(void *chip, UINT32 length, DEV_SMPL **buffer)
 	INT32 dacout;
 	FM_CH   *cch[6];
 	INT32 lt,rt;
+	UINT8 egMask;
+	UINT8 c;
 
 	/* set buffer */
 	if (buffer != NULL)
@@ -4425,6 +4480,17 @@ void ym2612_update_one(void *chip, UINT32 length, DEV_SMPL **buffer)
 		update_ssg_eg_channel(&cch[5]->SLOT[SLOT1]);
 	}
 
+	/* Muted channels skip all operator output, so their envelopes only matter
+	   once they are unmuted. If requested, don't update them either. */
+	egMask = 0x3F;
+	if (F2612->SkipMutedEG)
+	{
+		for (c = 0; c < 6; c ++)
+		{
+			if (cch[c]->Muted)
+				egMask &= ~(1 << c);
+		}
+	}
 
 	/* buffering */
 	for(i=0; i < length ; i++)
@@ -4438,12 +4504,18 @@ void ym2612_update_one(void *chip, UINT32 length, DEV_SMPL **buffer)
 		out_fm[5] = 0;
 
 		/* update SSG-EG output */
-		update_ssg_eg_channel(&cch[0]->SLOT[SLOT1]);
-		update_ssg_eg_channel(&cch[1]->SLOT[SLOT1]);
-		update_ssg_eg_channel(&cch[2]->SLOT[SLOT1]);
-		update_ssg_eg_channel(&cch[3]->SLOT[SLOT1]);
-		update_ssg_eg_channel(&cch[4]->SLOT[SLOT1]);
-		update_ssg_eg_channel(&cch[5]->SLOT[SLOT1]);
+		if (egMask & 0x01)
+			update_ssg_eg_channel(&cch[0]->SLOT[SLOT1]);
+		if (egMask & 0x02)
+			update_ssg_eg_channel(&cch[1]->SLOT[SLOT1]);
+		if (egMask & 0x04)
+			update_ssg_eg_channel(&cch[2]->SLOT[SLOT1]);
+		if (egMask & 0x08)
+			update_ssg_eg_channel(&cch[3]->SLOT[SLOT1]);
+		if (egMask & 0x10)
+			update_ssg_eg_channel(&cch[4]->SLOT[SLOT1]);
+		if (egMask & 0x20)
+			update_ssg_eg_channel(&cch[5]->SLOT[SLOT1]);
 
 		/* calculate FM */
 		if (! F2612->dac_test)
@@ -4475,12 +4547,18 @@ void ym2612_update_one(void *chip, UINT32 length, DEV_SMPL **buffer)
 			OPN->eg_timer -= OPN->eg_timer_overflow;
 			OPN->eg_cnt++;
 
-			advance_eg_channel(OPN, &cch[0]->SLOT[SLOT1]);
-			advance_eg_channel(OPN, &cch[1]->SLOT[SLOT1]);
-			advance_eg_channel(OPN, &cch[2]->SLOT[SLOT1]);
-			advance_eg_channel(OPN, &cch[3]->SLOT[SLOT1]);
-			advance_eg_channel(OPN, &cch[4]->SLOT[SLOT1]);
-			advance_eg_channel(OPN, &cch[5]->SLOT[SLOT1]);
+			if (egMask & 0x01)
+				advance_eg_channel(OPN, &cch[0]->SLOT[SLOT1]);
+			if (egMask & 0x02)
+				advance_eg_channel(OPN, &cch[1]->SLOT[SLOT1]);
+			if (egMask & 0x04)
+				advance_eg_channel(OPN, &cch[2]->SLOT[SLOT1]);
+			if (egMask & 0x08)
+				advance_eg_channel(OPN, &cch[3]->SLOT[SLOT1]);
+			if (egMask & 0x10)
+				advance_eg_channel(OPN, &cch[4]->SLOT[SLOT1]);
+			if (egMask & 0x20)
+				advance_eg_channel(OPN, &cch[5]->SLOT[SLOT1]);
 		}
 
 		/* channels accumulator output clipping (14-bit max) */
@@ -4520,6 +4598,9 @@ void ym2612_update_one(void *chip, UINT32 length, DEV_SMPL **buffer)
 		lt += ((out_fm[5]>>0) & OPN->pan[10]);
 		rt += ((out_fm[5]>>0) & OPN->pan[11]);
 
+		if (F2612->TapMask)
+			ym2612_write_taps(F2612, i, lt, rt);
+
 		/* buffering */
 		if (F2612->WaveOutMode)
 		{
@@ -4792,6 +4873,18 @@ void ym2612_set_mute_mask(void *chip, UINT32 MuteMask)
 	return;
 }
 
+UINT8 ym2612_set_chn_taps(void *chip, UINT32 TapMask, DEV_SMPL** TapBufs)
+{
+	YM2612 *F2612 = (YM2612 *)chip;
+
+	/* pseudo-stereo holds the mixed output, so it can't be split into channels */
+	if (F2612->WaveOutMode && TapMask)
+		return 0xFF;
+	F2612->TapMask = TapMask & 0x7F;
+	F2612->TapBufs = TapBufs;
+	return 0x00;
+}
+
 void ym2612_set_options(void *chip, UINT32 Flags)
 {
 	YM2612 *F2612 = (YM2612 *)chip;
@@ -4800,6 +4893,7 @@ void ym2612_set_options(void *chip, UINT32 Flags)
 	PseudoStereo = (Flags >> 2) & 0x01;
 	F2612->WaveOutMode = (PseudoStereo) ? 0x01 : 0x00;
 	F2612->OPN.LegacyMode = (Flags >> 7) & 0x01;
+	F2612->SkipMutedEG = (Flags >> 6) & 0x01;
 	
 	return;
 }
@@ -159,6 +159,7 @@ static void sn76496_shutdown(void *chip);
 static void sn76496_reset(void *chip);
 static void sn76496_freq_limiter(void* chip, UINT32 sample_rate);
 static void sn76496_set_mute_mask(void *chip, UINT32 MuteMask);
+static UINT8 sn76496_set_chn_taps(void *chip, UINT32 TapMask, DEV_SMPL** TapBufs);
 static void sn76496_set_log_cb(void *info, DEVCB_LOG func, void* param);
 
 static UINT8 device_start_sn76496_mame(const SN76496_CFG* cfg, DEV_INFO* retDevInf);
@@ -169,6 +170,7 @@ static DEVDEF_RWFUNC devFunc[] =
 {
 	{RWF_REGISTER | RWF_WRITE, DEVRW_A8D8, 0, sn76496_w_mame},
 	{RWF_CHN_MUTE | RWF_WRITE, DEVRW_ALL, 0, sn76496_set_mute_mask},
+	{RWF_CHN_TAP | RWF_WRITE, DEVRW_ALL, 0, sn76496_set_chn_taps},
 	{0x00, 0x00, 0, NULL}
 };
 DEV_DEF devDef_SN76496_MAME =
@@ -227,6 +229,8 @@ struct _sn76496_state
 	
 	INT32 FNumLimit;
 	UINT32 MuteMsk[4];
+	UINT32 TapMask;
+	DEV_SMPL** TapBufs;
 	UINT8 NgpFlags;         // bit 7 - NGP Mode on/off, bit 0 - is 2nd NGP chip
 	sn76496_state* NgpChip2;    // pointer to other chip instance of T6W28
 };
@@ -333,6 +337,8 @@ static void sn76496_update(void* param, UINT32 samples, DEV_SMPL** outputs)
 	DEV_SMPL* rbuffer = outputs[1];
 	DEV_SMPL out = 0;
 	DEV_SMPL out2 = 0;
+	DEV_SMPL chnL;
+	DEV_SMPL chnR;
 	INT32 vol[4];
 	INT32 ggst[2];
 
@@ -458,14 +464,28 @@ static void sn76496_update(void* param, UINT32 samples, DEV_SMPL** outputs)
 				}
 				if (R->period[i] > 1 || i == 3)
 				{
-					out += vol[i] * R->volume[i] * ggst[0];
-					out2 += vol[i] * R->volume[i] * ggst[1];
+					chnL = vol[i] * R->volume[i] * ggst[0];
+					chnR = vol[i] * R->volume[i] * ggst[1];
 				}
 				else if (R->MuteMsk[i])
 				{
 					// Make Bipolar Output with PCM possible
-					out += R->volume[i] * ggst[0];
-					out2 += R->volume[i] * ggst[1];
+					chnL = R->volume[i] * ggst[0];
+					chnR = R->volume[i] * ggst[1];
+				}
+				else
+				{
+					chnL = chnR = 0;
+				}
+				out += chnL;
+				out2 += chnR;
+				
+				if (R->TapMask & (1 << i))
+				{
+					// same result as the final output with all other channels muted
+					if (R->negate) { chnL = -chnL; chnR = -chnR; }
+					R->TapBufs[i * 2 + 0][j] = chnL >> 1;
+					R->TapBufs[i * 2 + 1][j] = chnR >> 1;
 				}
 			}
 		}
@@ -613,6 +633,18 @@ static void sn76496_set_mute_mask(void *chip, UINT32 MuteMask)
 	return;
 }
 
+static UINT8 sn76496_set_chn_taps(void *chip, UINT32 TapMask, DEV_SMPL** TapBufs)
+{
+	sn76496_state *R = (sn76496_state*)chip;
+	
+	// The NeoGeoPocket mode splits channels across 2 chips, which isn't supported.
+	if (R->NgpFlags && TapMask)
+		return 0xFF;
+	R->TapMask = TapMask & 0x0F;
+	R->TapBufs = TapBufs;
+	return 0x00;
+}
+
 static void sn76496_set_log_cb(void *chip, DEVCB_LOG func, void* param)
 {
 	sn76496_state *R = (sn76496_state*)chip;
@@ -0,0 +1,28 @@
+#include "../stdtype.h"
+#include "cpu_simd.h"
+
+static UINT8 DetectCPU(void)
+{
+#if defined(VGM_SIMD_AVX2)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return SIMD_TYPE_AVX2;
+	return SIMD_TYPE_SSE2;
+#elif defined(VGM_SIMD_SSE2)
+	return SIMD_TYPE_SSE2;
+#elif defined(VGM_SIMD_NEON)
+	return SIMD_TYPE_NEON;
+#else
+	return SIMD_TYPE_NONE;
+#endif
+}
+
+UINT8 SIMD_Detect(void)
+{
+	// Concurrent first calls may both query the CPU, but they store the same value.
+	static volatile UINT8 simdType = 0xFF;
+	
+	if (simdType == 0xFF)
+		simdType = DetectCPU();
+	return simdType;
+}
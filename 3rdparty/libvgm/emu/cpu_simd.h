@@ -0,0 +1,44 @@
+#ifndef __CPU_SIMD_H__
+#define __CPU_SIMD_H__
+
+// Instruction sets the SIMD kernels can be built for.
+// Define VGM_NO_SIMD for the whole build to always use the scalar code.
+#ifndef VGM_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VGM_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) && ! defined(__INTEL_COMPILER)
+// GCC and Clang can build AVX2 kernels without enabling AVX2 for the whole file.
+#define VGM_SIMD_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define VGM_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif	// VGM_NO_SIMD
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "../stdtype.h"
+
+#define SIMD_TYPE_NONE	0x00
+#define SIMD_TYPE_SSE2	0x01
+#define SIMD_TYPE_AVX2	0x02
+#define SIMD_TYPE_NEON	0x03
+
+/**
+ * @brief Returns the best instruction set that kernels were built for and the CPU supports.
+ *        The CPU is only queried on the first call.
+ * @return one of the SIMD_TYPE_* constants
+ */
+UINT8 SIMD_Detect(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// __CPU_SIMD_H__
@@ -300,6 +300,31 @@ void daccontrol_update(void* info, UINT32 samples, DEV_SMPL** dummy)
 	return;
 }
 
+// Returns the number of samples that can be passed to daccontrol_update() before
+// it sends the next command. (Commands are sent at the end of the update.)
+// Updating in steps of this size is equivalent to updating sample by sample.
+UINT32 daccontrol_get_samples_until_cmd(void* info)
+{
+	dac_control* chip = (dac_control*)info;
+	RC_TYPE remain;
+	RC_TYPE steps;
+	
+	if (chip->Running & 0x80)	// disabled
+		return (UINT32)-1;
+	if (! (chip->Running & 0x01))	// stopped
+		return (UINT32)-1;
+	if (chip->stepCntr.inc == 0)
+		return (UINT32)-1;
+	
+	if (chip->stepCntr.val >= ((RC_TYPE)1 << RC_SHIFT))
+		return 1;
+	remain = ((RC_TYPE)1 << RC_SHIFT) - chip->stepCntr.val;
+	steps = (remain + chip->stepCntr.inc - 1) / chip->stepCntr.inc;
+	if (steps > (UINT32)-1)
+		return (UINT32)-1;
+	return (UINT32)steps;
+}
+
 UINT8 device_start_daccontrol(const DEV_GEN_CFG* cfg, DEV_INFO* retDevInf)
 {
 	dac_control* chip;
@@ -405,7 +430,7 @@ void daccontrol_setup_chip(void* info, DEV_INFO* devInf, UINT8 ChType, UINT16 Co
 	return;
 }
 
-void daccontrol_set_data(void* info, UINT8* Data, UINT32 DataLen, UINT8 StepSize, UINT8 StepBase)
+void daccontrol_set_data(void* info, const UINT8* Data, UINT32 DataLen, UINT8 StepSize, UINT8 StepBase)
 {
 	dac_control* chip = (dac_control*)info;
 	
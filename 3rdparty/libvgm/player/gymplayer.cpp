@@ -608,6 +608,7 @@ UINT8 GYMPlayer::Start(void)
 		
 		cDev->base.defInf.dataPtr = NULL;
 		cDev->base.linkDev = NULL;
+		cDev->base.tapHub = NULL;
 		cDev->optID = DeviceID2OptionID((UINT32)curDev);
 		
 		devOpts = (cDev->optID != (size_t)-1) ? &_devOpts[cDev->optID] : NULL;
@@ -637,6 +638,7 @@ UINT8 GYMPlayer::Start(void)
 		{
 			if (cDev->base.defInf.devDef->SetOptionBits != NULL)
 				cDev->base.defInf.devDef->SetOptionBits(cDev->base.defInf.dataPtr, devOpts->coreOpts);
+			RefreshMuting(*cDev, devOpts->muteOpts);
 			
 			_optDevMap[cDev->optID] = curDev;
 		}
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <string.h>
+#include <assert.h>
 
 #include "../stdtype.h"
 #include "../emu/EmuStructs.h"
@@ -27,6 +28,7 @@ void SetupLinkedDevices(VGM_BASEDEV* cBaseDev, SETUPLINKDEV_CB devCfgCB, void* c
 		if (cDevCur == NULL)
 			break;
 		cDevCur->linkDev = NULL;
+		cDevCur->tapHub = NULL;
 		if (cParent == NULL)
 			cBaseDev->linkDev = cDevCur;
 		else
@@ -58,6 +60,7 @@ void FreeDeviceTree(VGM_BASEDEV* cBaseDev, UINT8 freeBase)
 	cDevCur = cBaseDev;
 	while(cDevCur != NULL)
 	{
+		DevTap_Free(cDevCur);
 		if (cDevCur->defInf.dataPtr != NULL)
 		{
 			Resmpl_Deinit(&cDevCur->resmpl);
@@ -74,3 +77,244 @@ void FreeDeviceTree(VGM_BASEDEV* cBaseDev, UINT8 freeBase)
 	
 	return;
 }
+
+#define TAP_MAX_CHN	32	// limited by the size of the mute mask
+
+typedef struct _vgm_channel_tap VGM_CHNTAP;
+struct _vgm_channel_tap
+{
+	VGM_TAPHUB* hub;
+	UINT32 readPos;
+	DEV_SMPL* capBufs[2];	// captured channel output at the device's sample rate
+	RESMPL_STATE resmpl;	// mirrors the device's resampler, but reads from capBufs
+	WAVE_32BS* outBuf;
+};
+struct _vgm_tap_hub
+{
+	DEVFUNC_UPDATE devUpdate;	// the update function that was connected to the resampler
+	void* devData;
+	DEVFUNC_CHNTAP setTaps;
+	UINT32 tapMask;
+	UINT32 capSize;	// capture buffer size in samples
+	UINT32 writePos;
+	DEV_SMPL* tapPtrs[TAP_MAX_CHN * 2];	// write positions, handed to the sound core
+	VGM_CHNTAP* taps[TAP_MAX_CHN];
+};
+
+// Enlarges the capture buffer of every tap to hold at least minSize samples, keeping the
+// samples captured so far. Returns 0x00 on success, 0xFF if out of memory.
+static UINT8 DevTap_GrowCapture(VGM_TAPHUB* hub, UINT32 minSize)
+{
+	UINT32 newSize;
+	UINT8 curChn;
+	
+	newSize = hub->capSize * 2;
+	if (newSize < minSize)
+		newSize = minSize;
+	for (curChn = 0; curChn < TAP_MAX_CHN; curChn ++)
+	{
+		VGM_CHNTAP* tap = hub->taps[curChn];
+		DEV_SMPL* newBuf;
+		if (tap == NULL)
+			continue;
+		newBuf = (DEV_SMPL*)malloc(newSize * 2 * sizeof(DEV_SMPL));
+		if (newBuf == NULL)
+			return 0xFF;
+		memcpy(&newBuf[0], tap->capBufs[0], hub->writePos * sizeof(DEV_SMPL));
+		memcpy(&newBuf[newSize], tap->capBufs[1], hub->writePos * sizeof(DEV_SMPL));
+		free(tap->capBufs[0]);
+		tap->capBufs[0] = &newBuf[0];
+		tap->capBufs[1] = &newBuf[newSize];
+	}
+	hub->capSize = newSize;
+	
+	return 0x00;
+}
+
+static void DevTap_WriteCapture(void* info, UINT32 samples, DEV_SMPL** outputs)
+{
+	VGM_TAPHUB* hub = (VGM_TAPHUB*)info;
+	UINT8 curChn;
+	
+	// Everything captured since the last DevTap_Execute call is still unread. A single
+	// resampler request fits into the initial buffer, but a render step longer than about
+	// one second is made of several requests, so enlarge the buffer instead of dropping
+	// or overwriting samples.
+	if (hub->writePos + samples > hub->capSize)
+	{
+		UINT8 retVal = DevTap_GrowCapture(hub, hub->writePos + samples);
+		assert(retVal == 0x00);
+		if (retVal)
+			hub->writePos = 0;	// out of memory: overwrite old data instead of running out of bounds
+	}
+	for (curChn = 0; curChn < TAP_MAX_CHN; curChn ++)
+	{
+		VGM_CHNTAP* tap = hub->taps[curChn];
+		if (tap == NULL)
+			continue;
+		hub->tapPtrs[curChn * 2 + 0] = &tap->capBufs[0][hub->writePos];
+		hub->tapPtrs[curChn * 2 + 1] = &tap->capBufs[1][hub->writePos];
+	}
+	
+	hub->devUpdate(hub->devData, samples, outputs);
+	hub->writePos += samples;
+	
+	return;
+}
+
+static void DevTap_ReadCapture(void* info, UINT32 samples, DEV_SMPL** outputs)
+{
+	VGM_CHNTAP* tap = (VGM_CHNTAP*)info;
+	UINT32 avail;
+	
+	// The tap's resampler runs in lockstep with the device's resampler,
+	// so it requests exactly the samples that were captured.
+	avail = (tap->readPos < tap->hub->writePos) ? (tap->hub->writePos - tap->readPos) : 0;
+	if (avail > samples)
+		avail = samples;
+	memcpy(outputs[0], &tap->capBufs[0][tap->readPos], avail * sizeof(DEV_SMPL));
+	memcpy(outputs[1], &tap->capBufs[1][tap->readPos], avail * sizeof(DEV_SMPL));
+	memset(&outputs[0][avail], 0x00, (samples - avail) * sizeof(DEV_SMPL));
+	memset(&outputs[1][avail], 0x00, (samples - avail) * sizeof(DEV_SMPL));
+	tap->readPos += samples;
+	
+	return;
+}
+
+static void DevTap_FreeTap(VGM_CHNTAP* tap)
+{
+	Resmpl_Deinit(&tap->resmpl);
+	free(tap->capBufs[0]);
+	free(tap);
+	
+	return;
+}
+
+UINT8 DevTap_Add(VGM_BASEDEV* cDev, UINT8 chnID, WAVE_32BS* outBuf)
+{
+	VGM_TAPHUB* hub;
+	VGM_CHNTAP* tap;
+	DEV_SMPL* rsBuf;
+	UINT8 newHub;
+	
+	if (cDev->defInf.dataPtr == NULL || cDev->resmpl.smplBufs[0] == NULL || chnID >= TAP_MAX_CHN)
+		return 0xFF;
+	
+	hub = cDev->tapHub;
+	newHub = (hub == NULL);
+	if (newHub)
+	{
+		DEVFUNC_CHNTAP setTaps = NULL;
+		UINT8 retVal = SndEmu_GetDeviceFunc(cDev->defInf.devDef, RWF_CHN_TAP | RWF_WRITE, DEVRW_ALL, 0, (void**)&setTaps);
+		if (retVal == EERR_NOT_FOUND || setTaps == NULL)
+			return 0xFF;
+		
+		hub = (VGM_TAPHUB*)calloc(1, sizeof(VGM_TAPHUB));
+		if (hub == NULL)
+			return 0xFF;
+		hub->devUpdate = cDev->resmpl.StreamUpdate;
+		hub->devData = cDev->resmpl.su_DataPtr;
+		hub->setTaps = setTaps;
+		hub->capSize = cDev->resmpl.smplBufSize;
+	}
+	else if (hub->taps[chnID] != NULL)
+	{
+		hub->taps[chnID]->outBuf = outBuf;
+		return 0x00;
+	}
+	
+	tap = (VGM_CHNTAP*)calloc(1, sizeof(VGM_CHNTAP));
+	if (tap == NULL)
+		goto fail_hub;
+	tap->hub = hub;
+	tap->outBuf = outBuf;
+	tap->capBufs[0] = (DEV_SMPL*)malloc(hub->capSize * 2 * sizeof(DEV_SMPL));
+	if (tap->capBufs[0] == NULL)
+		goto fail_tap;
+	tap->capBufs[1] = &tap->capBufs[0][hub->capSize];
+	rsBuf = (DEV_SMPL*)malloc(cDev->resmpl.smplBufSize * 2 * sizeof(DEV_SMPL));
+	if (rsBuf == NULL)
+		goto fail_buf;
+	
+	hub->tapPtrs[chnID * 2 + 0] = tap->capBufs[0];
+	hub->tapPtrs[chnID * 2 + 1] = tap->capBufs[1];
+	if (hub->setTaps(hub->devData, hub->tapMask | (1u << chnID), hub->tapPtrs))
+		goto fail_rsbuf;
+	hub->tapMask |= (1u << chnID);
+	hub->taps[chnID] = tap;
+	
+	// Copy the complete resampler state, so that both resamplers request the same sample counts.
+	// (Taps are added before rendering, and the sound core applies muting after the resampler's
+	// initial sample was generated, so this also matches the state of a solo render.)
+	tap->resmpl = cDev->resmpl;
+	tap->resmpl.StreamUpdate = DevTap_ReadCapture;
+	tap->resmpl.su_DataPtr = tap;
+	tap->resmpl.smplBufs[0] = rsBuf;
+	tap->resmpl.smplBufs[1] = &tap->resmpl.smplBufs[0][tap->resmpl.smplBufSize];
+	
+	if (newHub)
+	{
+		cDev->resmpl.StreamUpdate = DevTap_WriteCapture;
+		cDev->resmpl.su_DataPtr = hub;
+		cDev->tapHub = hub;
+	}
+	return 0x00;
+	
+fail_rsbuf:
+	free(rsBuf);
+fail_buf:
+	free(tap->capBufs[0]);
+fail_tap:
+	free(tap);
+fail_hub:
+	if (newHub)
+		free(hub);
+	return 0xFF;
+}
+
+void DevTap_Execute(VGM_BASEDEV* cDev, UINT32 samples, UINT32 outOfs)
+{
+	VGM_TAPHUB* hub = cDev->tapHub;
+	UINT8 curChn;
+	
+	if (hub == NULL)
+		return;
+	
+	for (curChn = 0; curChn < TAP_MAX_CHN; curChn ++)
+	{
+		VGM_CHNTAP* tap = hub->taps[curChn];
+		if (tap == NULL)
+			continue;
+		// follow sample rate changes of the device
+		if (tap->resmpl.smpRateSrc != cDev->resmpl.smpRateSrc)
+			Resmpl_ChangeRate(&tap->resmpl, cDev->resmpl.smpRateSrc);
+		Resmpl_Execute(&tap->resmpl, samples, &tap->outBuf[outOfs]);
+		tap->readPos = 0;
+	}
+	hub->writePos = 0;
+	
+	return;
+}
+
+void DevTap_Free(VGM_BASEDEV* cDev)
+{
+	VGM_TAPHUB* hub = cDev->tapHub;
+	UINT8 curChn;
+	
+	if (hub == NULL)
+		return;
+	
+	if (cDev->defInf.dataPtr != NULL)
+		hub->setTaps(hub->devData, 0x00, NULL);
+	for (curChn = 0; curChn < TAP_MAX_CHN; curChn ++)
+	{
+		if (hub->taps[curChn] != NULL)
+			DevTap_FreeTap(hub->taps[curChn]);
+	}
+	cDev->resmpl.StreamUpdate = hub->devUpdate;
+	cDev->resmpl.su_DataPtr = hub->devData;
+	cDev->tapHub = NULL;
+	free(hub);
+	
+	return;
+}
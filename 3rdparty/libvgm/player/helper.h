@@ -10,12 +10,15 @@ extern "C"
 #include "../emu/EmuStructs.h"
 #include "../emu/Resampler.h"
 
+typedef struct _vgm_tap_hub VGM_TAPHUB;
+
 typedef struct _vgm_base_device VGM_BASEDEV;
 struct _vgm_base_device
 {
 	DEV_INFO defInf;
 	RESMPL_STATE resmpl;
 	VGM_BASEDEV* linkDev;
+	VGM_TAPHUB* tapHub;	// per-channel output taps, NULL if unused
 };
 
 // callback function typedef for SetupLinkedDevices
@@ -25,6 +28,34 @@ typedef void (*SETUPLINKDEV_CB)(void* userParam, VGM_BASEDEV* cDev, DEVLINK_INFO
 void SetupLinkedDevices(VGM_BASEDEV* cBaseDev, SETUPLINKDEV_CB devCfgCB, void* cbUserParam);
 void FreeDeviceTree(VGM_BASEDEV* cBaseDev, UINT8 freeBase);
 
+// ---- per-channel output taps ----
+// A tap captures the output of a single channel while the device renders its regular output,
+// and resamples it like the device's own resampler does.
+/**
+ * @brief Adds a channel tap to a running device.
+ *
+ * @param cDev device to be tapped, must have an initialized resampler
+ * @param chnID channel index, uses the same numbering as the device's mute mask
+ * @param outBuf buffer that receives the resampled channel output (added to, like Resmpl_Execute)
+ * @return 0x00 on success, 0xFF if the sound core doesn't support channel taps
+ */
+UINT8 DevTap_Add(VGM_BASEDEV* cDev, UINT8 chnID, WAVE_32BS* outBuf);
+/**
+ * @brief Resamples the channel data captured by the last Resmpl_Execute call of the device.
+ *        Must be called after every Resmpl_Execute of a tapped device, with the same sample count.
+ *
+ * @param cDev device whose taps are processed
+ * @param samples number of output samples to be rendered
+ * @param outOfs offset into the tap output buffers
+ */
+void DevTap_Execute(VGM_BASEDEV* cDev, UINT32 samples, UINT32 outOfs);
+/**
+ * @brief Removes all channel taps from a device.
+ *
+ * @param cDev device whose taps are removed
+ */
+void DevTap_Free(VGM_BASEDEV* cDev);
+
 #ifdef __cplusplus
 }
 #endif
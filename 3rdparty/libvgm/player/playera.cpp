@@ -6,15 +6,31 @@
 #include "../utils/DataLoader.h"
 #include "playerbase.hpp"
 #include "../emu/Resampler.h"
+#include "../emu/cpu_simd.h"
 
 #include "playera.hpp"
 
+#if 1
+#define VOLCALC64
+#define VOL_BITS	16	// use .X fixed point for working volume
+#else
+#define VOL_BITS	8	// use .X fixed point for working volume
+#endif
+#define VOL_SHIFT	(16 - VOL_BITS)	// shift for master volume -> working volume
+
+// Pre- and post-shifts are used to make the calculations as accurate as possible
+// without causing the sample data (likely 24 bits) to overflow while applying the volume gain.
+// Smaller values for VOL_PRESH are more accurate, but have a higher risk of overflows during calculations.
+// (24 + VOL_POSTSH) must NOT be larger than 31
+#define VOL_PRESH	4	// sample data pre-shift
+#define VOL_POSTSH	(VOL_BITS - VOL_PRESH)	// post-shift after volume multiplication
+
 struct int24_s
 {
 	INT32 data : 24;
 };
 
-static void SampleConv_toU8(void* buffer, INT32 value)
+INLINE void SampleConv_toU8(void* buffer, INT32 value)
 {
 	value >>= 16;	// 24 bit -> 8 bit
 	if (value < -0x80)
@@ -25,7 +41,7 @@ static void SampleConv_toU8(void* buffer, INT32 value)
 	return;
 }
 
-static void SampleConv_toS16(void* buffer, INT32 value)
+INLINE void SampleConv_toS16(void* buffer, INT32 value)
 {
 	value >>= 8;	// 24 bit -> 16 bit
 	if (value < -0x8000)
@@ -36,7 +52,7 @@ static void SampleConv_toS16(void* buffer, INT32 value)
 	return;
 }
 
-static void SampleConv_toS24(void* buffer, INT32 value)
+INLINE void SampleConv_toS24(void* buffer, INT32 value)
 {
 	if (value < -0x800000)
 		value = -0x800000;
@@ -46,7 +62,7 @@ static void SampleConv_toS24(void* buffer, INT32 value)
 	return;
 }
 
-static void SampleConv_toS32(void* buffer, INT32 value)
+INLINE void SampleConv_toS32(void* buffer, INT32 value)
 {
 	// internal scale is 24-bit, so limit to that
 	if (value < -0x800000)
@@ -58,23 +74,243 @@ static void SampleConv_toS32(void* buffer, INT32 value)
 	return;
 }
 
-static void SampleConv_toF32(void* buffer, INT32 value)
+INLINE void SampleConv_toF32(void* buffer, INT32 value)
 {
 	// limiting not required here
 	*(float*)buffer = value / (float)0x800000;
 	return;
 }
 
+INLINE WAVE_32BS ApplyVolume(WAVE_32BS fnlSmpl, INT32 volume, UINT8 chnInvert)
+{
+	// Input is about 24 bits (some cores might output a bit more)
+#ifdef VOLCALC64
+	fnlSmpl.L = (INT32)( ((INT64)fnlSmpl.L * volume) >> VOL_BITS );
+	fnlSmpl.R = (INT32)( ((INT64)fnlSmpl.R * volume) >> VOL_BITS );
+#else
+	fnlSmpl.L = ((fnlSmpl.L >> VOL_PRESH) * volume) >> VOL_POSTSH;
+	fnlSmpl.R = ((fnlSmpl.R >> VOL_PRESH) * volume) >> VOL_POSTSH;
+#endif
+	
+	if (chnInvert & 0x01)
+		fnlSmpl.L = -fnlSmpl.L;
+	if (chnInvert & 0x02)
+		fnlSmpl.R = -fnlSmpl.R;
+	return fnlSmpl;
+}
+
+// Applies volume/phase inversion to a block of samples and converts them to the output format.
+// Instantiated once per sample format, so the conversion is inlined.
+template<void (*SampleConv)(void*, INT32), UINT32 SMPL_SIZE>
+static void SamplePack_Generic(UINT8* buffer, const WAVE_32BS* smpls, UINT32 count, INT32 volume, UINT8 chnInvert)
+{
+	for (UINT32 curSmpl = 0; curSmpl < count; curSmpl ++)
+	{
+		WAVE_32BS fnlSmpl = ApplyVolume(smpls[curSmpl], volume, chnInvert);
+		SampleConv(&buffer[(curSmpl * 2 + 0) * SMPL_SIZE], fnlSmpl.L);
+		SampleConv(&buffer[(curSmpl * 2 + 1) * SMPL_SIZE], fnlSmpl.R);
+	}
+	return;
+}
+
+// The SIMD kernels give the same output as SamplePack_Generic with the matching SampleConv
+// function. They require VOLCALC64, volume >= 0 and no phase inversion, and return the
+// number of samples processed. (The caller packs the remaining samples.)
+#if defined(VOLCALC64) && defined(VGM_SIMD_SSE2)
+// applies the volume to 2 stereo samples, like ApplyVolume()
+static inline __m128i ApplyVolume_SSE2(__m128i smpl, __m128i vol)
+{
+	const __m128i loMask = _mm_set_epi32(0, -1, 0, -1);
+	__m128i even;
+	__m128i odd;
+	__m128i corr;
+	
+	// SSE2 only has unsigned 32x32 -> 64-bit multiplication. For negative samples,
+	// the unsigned product is too large by (volume << 32), so subtract (volume << 16)
+	// after shifting.
+	even = _mm_srli_epi64(_mm_mul_epu32(smpl, vol), VOL_BITS);
+	odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(smpl, 32), vol), VOL_BITS);
+	corr = _mm_slli_epi32(_mm_and_si128(_mm_srai_epi32(smpl, 31), vol), 32 - VOL_BITS);
+	smpl = _mm_or_si128(_mm_and_si128(even, loMask), _mm_slli_epi64(odd, 32));
+	return _mm_sub_epi32(smpl, corr);
+}
+
+static UINT32 SamplePack_S16_SSE2(UINT8* buffer, const WAVE_32BS* smpls, UINT32 count, INT32 volume)
+{
+	const __m128i vol = _mm_set1_epi32(volume);
+	__m128i smpl[2];
+	UINT32 curSmpl;
+	int i;
+	
+	for (curSmpl = 0; curSmpl + 4 <= count; curSmpl += 4)
+	{
+		for (i = 0; i < 2; i ++)
+		{
+			smpl[i] = ApplyVolume_SSE2(_mm_loadu_si128((const __m128i*)&smpls[curSmpl + i * 2]), vol);
+			smpl[i] = _mm_srai_epi32(smpl[i], 8);	// 24 bit -> 16 bit
+		}
+		// saturate to 16 bits
+		_mm_storeu_si128((__m128i*)&buffer[curSmpl * 4], _mm_packs_epi32(smpl[0], smpl[1]));
+	}
+	return curSmpl;
+}
+
+static UINT32 SamplePack_F32_SSE2(UINT8* buffer, const WAVE_32BS* smpls, UINT32 count, INT32 volume)
+{
+	const __m128i vol = _mm_set1_epi32(volume);
+	const __m128 scale = _mm_set1_ps(1.0f / 0x800000);
+	__m128i smpl;
+	UINT32 curSmpl;
+	
+	for (curSmpl = 0; curSmpl + 2 <= count; curSmpl += 2)
+	{
+		smpl = ApplyVolume_SSE2(_mm_loadu_si128((const __m128i*)&smpls[curSmpl]), vol);
+		// scaling by a power of 2 is exact, so this rounds like SampleConv_toF32
+		_mm_storeu_ps((float*)&buffer[curSmpl * 8], _mm_mul_ps(_mm_cvtepi32_ps(smpl), scale));
+	}
+	return curSmpl;
+}
+#endif
+
+#if defined(VOLCALC64) && defined(VGM_SIMD_AVX2)
+// applies the volume to 4 stereo samples, like ApplyVolume()
+__attribute__((target("avx2")))
+static inline __m256i ApplyVolume_AVX2(__m256i smpl, __m256i vol)
+{
+	// low 32 bits of the (signed) 64-bit products, shifted right by VOL_BITS
+	__m256i even = _mm256_srli_epi64(_mm256_mul_epi32(smpl, vol), VOL_BITS);
+	__m256i odd = _mm256_srli_epi64(_mm256_mul_epi32(_mm256_srli_epi64(smpl, 32), vol), VOL_BITS);
+	return _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+}
+
+__attribute__((target("avx2")))
+static UINT32 SamplePack_S16_AVX2(UINT8* buffer, const WAVE_32BS* smpls, UINT32 count, INT32 volume)
+{
+	const __m256i vol = _mm256_set1_epi32(volume);
+	__m256i smpl[2];
+	UINT32 curSmpl;
+	int i;
+	
+	for (curSmpl = 0; curSmpl + 8 <= count; curSmpl += 8)
+	{
+		for (i = 0; i < 2; i ++)
+		{
+			smpl[i] = ApplyVolume_AVX2(_mm256_loadu_si256((const __m256i*)&smpls[curSmpl + i * 4]), vol);
+			smpl[i] = _mm256_srai_epi32(smpl[i], 8);	// 24 bit -> 16 bit
+		}
+		// saturate to 16 bits (packs works within 128-bit lanes, so restore the sample order)
+		_mm256_storeu_si256((__m256i*)&buffer[curSmpl * 4],
+			_mm256_permute4x64_epi64(_mm256_packs_epi32(smpl[0], smpl[1]), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+	return curSmpl;
+}
+
+__attribute__((target("avx2")))
+static UINT32 SamplePack_F32_AVX2(UINT8* buffer, const WAVE_32BS* smpls, UINT32 count, INT32 volume)
+{
+	const __m256i vol = _mm256_set1_epi32(volume);
+	const __m256 scale = _mm256_set1_ps(1.0f / 0x800000);
+	__m256i smpl;
+	UINT32 curSmpl;
+	
+	for (curSmpl = 0; curSmpl + 4 <= count; curSmpl += 4)
+	{
+		smpl = ApplyVolume_AVX2(_mm256_loadu_si256((const __m256i*)&smpls[curSmpl]), vol);
+		// scaling by a power of 2 is exact, so this rounds like SampleConv_toF32
+		_mm256_storeu_ps((float*)&buffer[curSmpl * 8], _mm256_mul_ps(_mm256_cvtepi32_ps(smpl), scale));
+	}
+	return curSmpl;
+}
+#endif
+
+#if defined(VOLCALC64) && defined(VGM_SIMD_NEON)
+// applies the volume to 2 stereo samples, like ApplyVolume()
+static inline int32x4_t ApplyVolume_NEON(int32x4_t smpl, int32x2_t vol)
+{
+	// vshrn keeps the low 32 bits of the shifted 64-bit products
+	return vcombine_s32(vshrn_n_s64(vmull_s32(vget_low_s32(smpl), vol), VOL_BITS),
+					vshrn_n_s64(vmull_s32(vget_high_s32(smpl), vol), VOL_BITS));
+}
+
+static UINT32 SamplePack_S16_NEON(UINT8* buffer, const WAVE_32BS* smpls, UINT32 count, INT32 volume)
+{
+	const int32x2_t vol = vdup_n_s32(volume);
+	int32x4_t res;
+	UINT32 curSmpl;
+	
+	for (curSmpl = 0; curSmpl + 2 <= count; curSmpl += 2)
+	{
+		res = ApplyVolume_NEON(vld1q_s32((const int32_t*)&smpls[curSmpl]), vol);
+		// 24 bit -> 16 bit, saturated
+		vst1_s16((int16_t*)&buffer[curSmpl * 4], vqmovn_s32(vshrq_n_s32(res, 8)));
+	}
+	return curSmpl;
+}
+
+static UINT32 SamplePack_F32_NEON(UINT8* buffer, const WAVE_32BS* smpls, UINT32 count, INT32 volume)
+{
+	const int32x2_t vol = vdup_n_s32(volume);
+	int32x4_t res;
+	UINT32 curSmpl;
+	
+	for (curSmpl = 0; curSmpl + 2 <= count; curSmpl += 2)
+	{
+		res = ApplyVolume_NEON(vld1q_s32((const int32_t*)&smpls[curSmpl]), vol);
+		// scaling by a power of 2 is exact, so this rounds like SampleConv_toF32
+		vst1q_f32((float*)&buffer[curSmpl * 8], vmulq_n_f32(vcvtq_f32_s32(res), 1.0f / 0x800000));
+	}
+	return curSmpl;
+}
+#endif
+
+template<UINT32 (*SamplePackSIMD)(UINT8*, const WAVE_32BS*, UINT32, INT32),
+	void (*SampleConv)(void*, INT32), UINT32 SMPL_SIZE>
+static void SamplePack_SIMD(UINT8* buffer, const WAVE_32BS* smpls, UINT32 count, INT32 volume, UINT8 chnInvert)
+{
+	UINT32 done = 0;
+	
+	if (volume >= 0 && ! chnInvert)
+		done = SamplePackSIMD(buffer, smpls, count, volume);
+	SamplePack_Generic<SampleConv, SMPL_SIZE>(&buffer[done * 2 * SMPL_SIZE], &smpls[done], count - done, volume, chnInvert);
+	return;
+}
+
 static PlayerA::PLR_SMPL_PACK GetSampleConvFunc(UINT8 bits)
 {
 	if (bits == 8)
-		return SampleConv_toU8;
+		return SamplePack_Generic<SampleConv_toU8, 1>;
 	else if (bits == 16)
-		return SampleConv_toS16;
+	{
+#if defined(VOLCALC64) && defined(VGM_SIMD_AVX2)
+		if (SIMD_Detect() == SIMD_TYPE_AVX2)
+			return SamplePack_SIMD<SamplePack_S16_AVX2, SampleConv_toS16, 2>;
+#endif
+#if defined(VOLCALC64) && defined(VGM_SIMD_SSE2)
+		return SamplePack_SIMD<SamplePack_S16_SSE2, SampleConv_toS16, 2>;
+#elif defined(VOLCALC64) && defined(VGM_SIMD_NEON)
+		return SamplePack_SIMD<SamplePack_S16_NEON, SampleConv_toS16, 2>;
+#else
+		return SamplePack_Generic<SampleConv_toS16, 2>;
+#endif
+	}
 	else if (bits == 24)
-		return SampleConv_toS24;
+		return SamplePack_Generic<SampleConv_toS24, 3>;
 	else if (bits == 32)
-		return SampleConv_toS32;
+		return SamplePack_Generic<SampleConv_toS32, 4>;
+	else if (bits == (32 | PLR_SMPL_FLOAT))
+	{
+#if defined(VOLCALC64) && defined(VGM_SIMD_AVX2)
+		if (SIMD_Detect() == SIMD_TYPE_AVX2)
+			return SamplePack_SIMD<SamplePack_F32_AVX2, SampleConv_toF32, 4>;
+#endif
+#if defined(VOLCALC64) && defined(VGM_SIMD_SSE2)
+		return SamplePack_SIMD<SamplePack_F32_SSE2, SampleConv_toF32, 4>;
+#elif defined(VOLCALC64) && defined(VGM_SIMD_NEON)
+		return SamplePack_SIMD<SamplePack_F32_NEON, SampleConv_toF32, 4>;
+#else
+		return SamplePack_Generic<SampleConv_toF32, 4>;
+#endif
+	}
 	else
 		return NULL;
 }
@@ -151,9 +387,16 @@ UINT8 PlayerA::SetOutputSettings(UINT32 smplRate, UINT8 channels, UINT8 smplBits
 	_outSmplBits = smplBits;
 	_outSmplPack = smplPackFunc;
 	SetSampleRate(smplRate);
-	_outSmplSize1 = _outSmplBits / 8;
+	_outSmplSize1 = (_outSmplBits & ~PLR_SMPL_FLOAT) / 8;
 	_outSmplSizeA = _outSmplSize1 * _outSmplChns;
 	_smplBuf.resize(smplBufferLen);
+	for (size_t curTap = 0; curTap < _taps.size(); curTap ++)
+	{
+		// the buffer may move, so tell the player about the new location
+		ChannelTap& tap = _taps[curTap];
+		tap.smplBuf.resize(smplBufferLen);
+		_player->SetChannelTap(tap.id, tap.subChip, tap.chnID, &tap.smplBuf[0]);
+	}
 	return 0x00;
 }
 
@@ -413,6 +656,7 @@ UINT8 PlayerA::Stop(void)
 {
 	if (_player == NULL)
 		return 0xFF;
+	_taps.clear();	// the player engine frees its taps when stopping
 	UINT8 retVal = _player->Stop();
 	_myPlayState = _player->GetState() & (PLAYSTATE_PLAY | PLAYSTATE_END);
 	_myPlayState |= PLAYSTATE_FIN;
@@ -454,20 +698,29 @@ UINT8 PlayerA::Seek(UINT8 unit, UINT32 pos)
 	return retVal;
 }
 
-#if 1
-#define VOLCALC64
-#define VOL_BITS	16	// use .X fixed point for working volume
-#else
-#define VOL_BITS	8	// use .X fixed point for working volume
-#endif
-#define VOL_SHIFT	(16 - VOL_BITS)	// shift for master volume -> working volume
+size_t PlayerA::AddChannelTap(UINT32 id, UINT8 subChip, UINT8 chnID)
+{
+	if (_player == NULL || ! (_player->GetState() & PLAYSTATE_PLAY))
+		return (size_t)-1;
+	
+	ChannelTap tap;
+	tap.id = id;
+	tap.subChip = subChip;
+	tap.chnID = chnID;
+	tap.smplBuf.resize(_smplBuf.size());
+	UINT8 retVal = _player->SetChannelTap(id, subChip, chnID, &tap.smplBuf[0]);
+	if (retVal)
+		return (size_t)-1;
+	
+	// moving the vector keeps the buffer address that was passed to the player
+	_taps.push_back(std::move(tap));
+	return _taps.size() - 1;
+}
 
-// Pre- and post-shifts are used to make the calculations as accurate as possible
-// without causing the sample data (likely 24 bits) to overflow while applying the volume gain.
-// Smaller values for VOL_PRESH are more accurate, but have a higher risk of overflows during calculations.
-// (24 + VOL_POSTSH) must NOT be larger than 31
-#define VOL_PRESH	4	// sample data pre-shift
-#define VOL_POSTSH	(VOL_BITS - VOL_PRESH)	// post-shift after volume multiplication
+size_t PlayerA::GetChannelTapCount(void) const
+{
+	return _taps.size();
+}
 
 // 16.16 fixed point multiplication
 #define MUL16X16_FIXED(a, b)	(INT32)(((INT64)a * b) >> 16)
@@ -514,13 +767,18 @@ INT32 PlayerA::CalcCurrentVolume(UINT32 playbackSmpl)
 }
 
 UINT32 PlayerA::Render(UINT32 bufSize, void* data)
+{
+	return Render(bufSize, data, NULL);
+}
+
+UINT32 PlayerA::Render(UINT32 bufSize, void* data, void* const* tapData)
 {
 	UINT8* bData = (UINT8*)data;
 	UINT32 basePbSmpl;
 	UINT32 smplCount;
 	UINT32 smplRendered;
 	UINT32 curSmpl;
-	WAVE_32BS fnlSmpl;	// final sample value
+	size_t curTap;
 	INT32 curVolume;
 	
 	smplCount = bufSize / _outSmplSizeA;
@@ -533,6 +791,11 @@ UINT32 PlayerA::Render(UINT32 bufSize, void* data)
 	{
 		//fprintf(stderr, "Player Warning: calling Render while not playing! playState = 0x%02X\n", _player->GetState());
 		memset(data, 0x00, smplCount * _outSmplSizeA);
+		if (tapData != NULL)
+		{
+			for (curTap = 0; curTap < _taps.size(); curTap ++)
+				memset(tapData[curTap], 0x00, smplCount * _outSmplSizeA);
+		}
 		return smplCount * _outSmplSizeA;
 	}
 	
@@ -545,6 +808,8 @@ UINT32 PlayerA::Render(UINT32 bufSize, void* data)
 	if (smplCount > (UINT32)_smplBuf.size())
 		smplCount = (UINT32)_smplBuf.size();
 	memset(&_smplBuf[0], 0, smplCount * sizeof(WAVE_32BS));
+	for (curTap = 0; curTap < _taps.size(); curTap ++)
+		memset(&_taps[curTap].smplBuf[0], 0, smplCount * sizeof(WAVE_32BS));
 	basePbSmpl = _player->GetCurPos(PLAYPOS_SAMPLE);
 	smplRendered = _player->Render(smplCount, &_smplBuf[0]);
 	smplCount = smplRendered;
@@ -552,6 +817,19 @@ UINT32 PlayerA::Render(UINT32 bufSize, void* data)
 	curVolume = CalcCurrentVolume(basePbSmpl) >> VOL_SHIFT;
 	for (curSmpl = 0; curSmpl < smplCount; curSmpl ++, basePbSmpl ++)
 	{
+		// Until fading or the end silence starts, the volume is constant, so pack all samples at once.
+		UINT32 evtSmpl = (_fadeSmplStart < _endSilenceStart) ? _fadeSmplStart : _endSilenceStart;
+		if (basePbSmpl < evtSmpl)
+		{
+			UINT32 blkCount = smplCount - curSmpl;
+			if (blkCount > evtSmpl - basePbSmpl)
+				blkCount = evtSmpl - basePbSmpl;
+			PackSamples(bData, tapData, curSmpl, blkCount, curVolume);
+			curSmpl += blkCount - 1;
+			basePbSmpl += blkCount - 1;
+			continue;
+		}
+		
 		if (basePbSmpl >= _fadeSmplStart)
 		{
 			UINT32 fadeSmpls = basePbSmpl - _fadeSmplStart;
@@ -579,29 +857,26 @@ UINT32 PlayerA::Render(UINT32 bufSize, void* data)
 			}
 		}
 		
-		// Input is about 24 bits (some cores might output a bit more)
-		fnlSmpl = _smplBuf[curSmpl];
-		
-#ifdef VOLCALC64
-		fnlSmpl.L = (INT32)( ((INT64)fnlSmpl.L * curVolume) >> VOL_BITS );
-		fnlSmpl.R = (INT32)( ((INT64)fnlSmpl.R * curVolume) >> VOL_BITS );
-#else
-		fnlSmpl.L = ((fnlSmpl.L >> VOL_PRESH) * curVolume) >> VOL_POSTSH;
-		fnlSmpl.R = ((fnlSmpl.R >> VOL_PRESH) * curVolume) >> VOL_POSTSH;
-#endif
-		
-		if (_config.chnInvert & 0x01)
-			fnlSmpl.L = -fnlSmpl.L;
-		if (_config.chnInvert & 0x02)
-			fnlSmpl.R = -fnlSmpl.R;
-		
-		_outSmplPack(&bData[(curSmpl * 2 + 0) * _outSmplSize1], fnlSmpl.L);
-		_outSmplPack(&bData[(curSmpl * 2 + 1) * _outSmplSize1], fnlSmpl.R);
+		PackSamples(bData, tapData, curSmpl, 1, curVolume);
 	}
 	
 	return curSmpl * _outSmplSizeA;
 }
 
+void PlayerA::PackSamples(UINT8* buffer, void* const* tapData, UINT32 smplStart, UINT32 smplCount, INT32 volume)
+{
+	_outSmplPack(&buffer[smplStart * _outSmplSizeA], &_smplBuf[smplStart], smplCount, volume, _config.chnInvert);
+	if (tapData != NULL)
+	{
+		for (size_t curTap = 0; curTap < _taps.size(); curTap ++)
+		{
+			UINT8* tData = (UINT8*)tapData[curTap];
+			_outSmplPack(&tData[smplStart * _outSmplSizeA], &_taps[curTap].smplBuf[smplStart], smplCount, volume, _config.chnInvert);
+		}
+	}
+	return;
+}
+
 /*static*/ UINT8 PlayerA::PlayCallbackS(PlayerBase* player, void* userParam, UINT8 evtType, void* evtParam)
 {
 	PlayerA* plr = (PlayerA*)userParam;
@@ -1,6 +1,7 @@
 #ifndef __PLAYERA_HPP__
 #define __PLAYERA_HPP__
 
+#include <stddef.h>
 #include <vector>
 #include "../stdtype.h"
 #include "../utils/DataLoader.h"
@@ -10,6 +11,10 @@
 #define PLAYSTATE_FADE	0x10	// is fading
 #define PLAYSTATE_FIN	0x20	// finished playing (file end + fading + trailing silence)
 
+// SetOutputSettings() smplBits flag: output IEEE float samples (only with 32 bits)
+// Full scale is +-1.0, and samples aren't clipped.
+#define PLR_SMPL_FLOAT	0x80
+
 // TODO: find a proper name for this class
 class PlayerA
 {
@@ -24,7 +29,8 @@ public:
 		UINT32 endSilenceSmpls;
 		double pbSpeed;
 	};
-	typedef void (*PLR_SMPL_PACK)(void* buffer, INT32 value);
+	// applies volume and phase inversion to smplCount stereo samples, and writes them in the output format
+	typedef void (*PLR_SMPL_PACK)(UINT8* buffer, const WAVE_32BS* smpls, UINT32 smplCount, INT32 volume, UINT8 chnInvert);
 
 	PlayerA();
 	~PlayerA();
@@ -69,11 +75,27 @@ public:
 	UINT8 Reset(void);
 	UINT8 FadeOut(void);
 	UINT8 Seek(UINT8 unit, UINT32 pos);
+	// Capture a single channel into a separate output stream, rendered in the same pass as the main output.
+	// Must be called after Start(), taps are removed by Stop().
+	// Returns the tap index or (size_t)-1, if the player or sound core doesn't support channel taps.
+	size_t AddChannelTap(UINT32 id, UINT8 subChip, UINT8 chnID);
+	size_t GetChannelTapCount(void) const;
 	UINT32 Render(UINT32 bufSize, void* data);
+	// Renders the main output into data and channel tap i into tapData[i] (using the same format and size).
+	UINT32 Render(UINT32 bufSize, void* data, void* const* tapData);
 private:
+	struct ChannelTap
+	{
+		UINT32 id;
+		UINT8 subChip;
+		UINT8 chnID;
+		std::vector<WAVE_32BS> smplBuf;
+	};
+	
 	void FindPlayerEngine(void);
 	INT32 CalcSongVolume(void);
 	INT32 CalcCurrentVolume(UINT32 playbackSmpl);
+	void PackSamples(UINT8* buffer, void* const* tapData, UINT32 smplStart, UINT32 smplCount, INT32 volume);
 	static UINT8 PlayCallbackS(PlayerBase* player, void* userParam, UINT8 evtType, void* evtParam);
 	UINT8 PlayCallback(PlayerBase* player, UINT8 evtType, void* evtParam);
 	
@@ -90,6 +112,7 @@ private:
 	UINT32 _outSmplSizeA;	// for all channels
 	PLR_SMPL_PACK _outSmplPack;
 	std::vector<WAVE_32BS> _smplBuf;
+	std::vector<ChannelTap> _taps;
 	PlayerBase* _player;
 	DATA_LOADER* _dLoad;
 	INT32 _songVolume;
@@ -53,6 +53,22 @@ UINT8 PlayerBase::CanLoadFile(DATA_LOADER *dataLoader) const
 	return 0x00;
 }
 
+UINT8 PlayerBase::SetChannelTap(UINT32 id, UINT8 subChip, UINT8 chnID, WAVE_32BS* tapBuf)
+{
+	return 0xFF;	// not supported
+}
+
+UINT8 PlayerBase::SetDeviceProfiling(UINT8 enable)
+{
+	return 0xFF;	// not supported
+}
+
+UINT8 PlayerBase::GetDeviceProfiles(std::vector<PLR_DEV_PROFILE>& profList) const
+{
+	profList.clear();
+	return 0xFF;	// not supported
+}
+
 UINT32 PlayerBase::GetSampleRate(void) const
 {
 	return _outSmplRate;
@@ -69,6 +69,17 @@ struct PLR_DEV_INFO
 	const DEV_GEN_CFG* devCfg;	// device configuration parameters
 };
 
+struct PLR_DEV_PROFILE
+{
+	UINT32 id;		// device ID
+	UINT8 type;		// device type
+	UINT8 instance;	// instance ID of this device type
+	UINT32 core;	// FCC of device emulation core
+	UINT32 smplRate;	// current sample rate of the device
+	UINT64 smplCount;	// number of rendered samples that were measured (scale: rendering sample rate)
+	UINT64 emuTime;	// time spent emulating the device (including linked devices) for those samples, in nanoseconds
+};
+
 struct PLR_MUTE_OPTS
 {
 	UINT8 disable;		// suspend emulation (0x01 = main device, 0x02 = linked, 0xFF = all)
@@ -119,6 +130,15 @@ public:
 	virtual UINT8 GetDeviceOptions(UINT32 id, PLR_DEV_OPTS& devOpts) const = 0;
 	virtual UINT8 SetDeviceMuting(UINT32 id, const PLR_MUTE_OPTS& muteOpts) = 0;
 	virtual UINT8 GetDeviceMuting(UINT32 id, PLR_MUTE_OPTS& muteOpts) const = 0;
+	// capture a single channel into tapBuf (added to, like the main output) while rendering
+	// only valid while playing, taps are removed by Stop()
+	// returns 0xFF if the player or the sound core doesn't support channel taps
+	virtual UINT8 SetChannelTap(UINT32 id, UINT8 subChip, UINT8 chnID, WAVE_32BS* tapBuf);
+	// measure the time spent emulating each device while rendering
+	// (only a fraction of all rendering steps is timed, in order to keep the overhead low)
+	// returns 0xFF if the player doesn't support device profiling
+	virtual UINT8 SetDeviceProfiling(UINT8 enable);
+	virtual UINT8 GetDeviceProfiles(std::vector<PLR_DEV_PROFILE>& profList) const;
 	// player-specific options
 	//virtual UINT8 SetPlayerOptions(const ###_PLAY_OPTIONS& playOpts) = 0;
 	//virtual UINT8 GetPlayerOptions(###_PLAY_OPTIONS& playOpts) const = 0;
@@ -932,6 +932,7 @@ UINT8 S98Player::Start(void)
 		cDev->base.defInf.dataPtr = NULL;
 		cDev->base.defInf.devDef = NULL;
 		cDev->base.linkDev = NULL;
+		cDev->base.tapHub = NULL;
 		deviceID = (devHdr->devType < S98DEV_END) ? S98_DEV_LIST[devHdr->devType] : 0xFF;
 		if (deviceID == 0xFF)
 			continue;
@@ -4,6 +4,7 @@
 #include <math.h>	// for pow()
 #include <vector>
 #include <string>
+#include <chrono>
 
 #define INLINE	static inline
 
@@ -144,7 +145,9 @@ VGMPlayer::VGMPlayer() :
 	_playSmpl(0),
 	_curLoop(0),
 	_playState(0x00),
-	_psTrigger(0x00)
+	_psTrigger(0x00),
+	_devProfiling(0),
+	_profStepCnt(0)
 {
 	UINT8 retVal;
 	UINT16 optChip;
@@ -154,6 +157,8 @@ VGMPlayer::VGMPlayer() :
 	
 	_playOpts.playbackHz = 0;
 	_playOpts.hardStopOld = 0;
+	_playOpts.skipDisabledDevs = 0;
+	_skippedDevVol = 0x00;
 	
 	for (optChip = 0x00; optChip < 0x100; optChip ++)
 	{
@@ -618,9 +623,15 @@ void VGMPlayer::RefreshMuting(VGMPlayer::CHIP_DEVICE& chipDev, const PLR_MUTE_OP
 {
 	VGM_BASEDEV* clDev;
 	UINT8 linkCntr = 0;
+	UINT8 disable = muteOpts.disable;
 	
-	for (clDev = &chipDev.base; clDev != NULL && linkCntr < 2; clDev = clDev->linkDev, linkCntr ++)
+	chipDev.disabled = CanSkipDevice(chipDev.vgmChipType);
+	for (clDev = &chipDev.base; clDev != NULL; clDev = clDev->linkDev, linkCntr ++, disable >>= 1)
 	{
+		if (! (disable & 0x01))
+			chipDev.disabled = 0;
+		if (linkCntr >= 2)
+			continue;
 		DEV_INFO* devInf = &clDev->defInf;
 		if (devInf->dataPtr != NULL && devInf->devDef->SetMuteMask != NULL)
 			devInf->devDef->SetMuteMask(devInf->dataPtr, muteOpts.chnMute[linkCntr]);
@@ -701,6 +712,55 @@ UINT8 VGMPlayer::GetDeviceMuting(UINT32 id, PLR_MUTE_OPTS& muteOpts) const
 	return 0x00;
 }
 
+UINT8 VGMPlayer::SetChannelTap(UINT32 id, UINT8 subChip, UINT8 chnID, WAVE_32BS* tapBuf)
+{
+	size_t optID = DeviceID2OptionID(id);
+	if (optID == (size_t)-1)
+		return 0x80;	// bad device ID
+	
+	size_t devID = _optDevMap[optID];
+	if (devID >= _devices.size())
+		return 0xFF;	// device not running
+	
+	VGM_BASEDEV* clDev = &_devices[devID].base;
+	for (; clDev != NULL && subChip > 0; clDev = clDev->linkDev, subChip --)
+		;
+	if (clDev == NULL)
+		return 0x81;	// bad sub-chip
+	return DevTap_Add(clDev, chnID, tapBuf);
+}
+
+UINT8 VGMPlayer::SetDeviceProfiling(UINT8 enable)
+{
+	_devProfiling = enable;
+	return 0x00;
+}
+
+UINT8 VGMPlayer::GetDeviceProfiles(std::vector<PLR_DEV_PROFILE>& profList) const
+{
+	size_t curDev;
+	
+	profList.clear();
+	profList.reserve(_devices.size());
+	for (curDev = 0; curDev < _devices.size(); curDev ++)
+	{
+		const CHIP_DEVICE* cDev = &_devices[curDev];
+		const VGM_BASEDEV* clDev = &cDev->base;
+		PLR_DEV_PROFILE devProf;
+		
+		devProf.id = PLR_DEV_ID(cDev->chipType, cDev->chipID);
+		devProf.type = cDev->chipType;
+		devProf.instance = cDev->chipID;
+		devProf.core = (clDev->defInf.devDef != NULL) ? clDev->defInf.devDef->coreID : 0x00;
+		devProf.smplRate = clDev->defInf.sampleRate;
+		devProf.smplCount = cDev->profSmpls;
+		devProf.emuTime = cDev->profTime;
+		profList.push_back(devProf);
+	}
+	
+	return 0x00;
+}
+
 UINT8 VGMPlayer::SetPlayerOptions(const VGM_PLAY_OPTIONS& playOpts)
 {
 	_playOpts = playOpts;
@@ -878,6 +938,8 @@ UINT8 VGMPlayer::Stop(void)
 		pcmBnk->bankOfs.clear();
 		pcmBnk->bankSize.clear();
 		pcmBnk->data.clear();
+		pcmBnk->dataPtr = NULL;
+		pcmBnk->dataSize = 0;
 	}
 	free(_pcmComprTbl.values.d8);	_pcmComprTbl.values.d8 = NULL;
 	
@@ -927,6 +989,8 @@ UINT8 VGMPlayer::Reset(void)
 		pcmBnk->bankOfs.clear();
 		pcmBnk->bankSize.clear();
 		pcmBnk->data.clear();
+		pcmBnk->dataPtr = NULL;
+		pcmBnk->dataSize = 0;
 	}
 	free(_pcmComprTbl.values.d8);	_pcmComprTbl.values.d8 = NULL;
 	memset(&_pcmComprTbl, 0x00, sizeof(PCM_COMPR_TBL));
@@ -1068,7 +1132,7 @@ UINT16 VGMPlayer::EstimateOverallVolume(void) const
 	const VGM_BASEDEV* clDev;
 	UINT16 absVol;
 	
-	absVol = 0x00;
+	absVol = _skippedDevVol;	// keep the volume the same as if all devices were running
 	for (curChip = 0; curChip < _devices.size(); curChip ++)
 	{
 		const CHIP_DEVICE& chipDev = _devices[curChip];
@@ -1286,6 +1350,7 @@ void VGMPlayer::InitDevices(void)
 	
 	_devices.clear();
 	_devNames.clear();
+	_skippedDevVol = 0x00;
 	{
 		UINT8 vgmChip;
 		UINT8 chipID;
@@ -1325,6 +1390,7 @@ void VGMPlayer::InitDevices(void)
 		chipDev.optID = _devOptMap[chipType][chipID];
 		chipDev.base.defInf.dataPtr = NULL;
 		chipDev.base.linkDev = NULL;
+		chipDev.base.tapHub = NULL;
 		
 		devOpts = (chipDev.optID != (size_t)-1) ? &_devOpts[chipDev.optID] : NULL;
 		devCfg->emuCore = (devOpts != NULL) ? devOpts->emuCore[0] : 0x00;
@@ -1334,6 +1400,23 @@ void VGMPlayer::InitDevices(void)
 		else
 			devCfg->smplRate = _outSmplRate;
 		
+		// Disabled devices aren't started, so they don't allocate any memory.
+		// Commands for them are ignored, the same way as for devices that failed to start.
+		if (_playOpts.skipDisabledDevs && devOpts != NULL && devOpts->muteOpts.disable == 0xFF &&
+			CanSkipDevice(sdCfg.vgmChipType))
+		{
+			// OPN SSG / OPL4 FM are linked devices, which count towards the volume as well.
+			UINT8 linkCnt = (chipType == DEVID_YM2203 || chipType == DEVID_YM2608 ||
+							chipType == DEVID_YM2610 || chipType == DEVID_YMF278B) ? 1 : 0;
+			UINT8 linkCntr;
+			for (linkCntr = 0; linkCntr <= linkCnt; linkCntr ++)
+			{
+				UINT16 chipVol = GetChipVolume(sdCfg.vgmChipType, chipID, linkCntr);
+				_skippedDevVol += MulFixed8x8(chipVol + chipVol, _PB_VOL_AMNT[sdCfg.vgmChipType]) / 2;
+			}
+			continue;
+		}
+		
 		switch(chipType)
 		{
 		case DEVID_SN76496:
@@ -1615,6 +1698,22 @@ VGMPlayer::CHIP_DEVICE* VGMPlayer::GetDevicePtr(UINT8 chipType, UINT8 chipID)
 	return &_devices[devID];
 }
 
+VGMPlayer::CHIP_DEVICE* VGMPlayer::GetWriteDevicePtr(UINT8 chipType, UINT8 chipID)
+{
+	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	if (cDev != NULL && cDev->disabled && _playOpts.skipDisabledDevs)
+		return NULL;
+	return cDev;
+}
+
+UINT8 VGMPlayer::CanSkipDevice(UINT8 vgmChipType) const
+{
+	// The two halves of a T6W28 read each other's registers.
+	if (vgmChipType == 0x00 && (GetHeaderChipClock(vgmChipType) & 0x80000000))
+		return 0;
+	return 1;
+}
+
 void VGMPlayer::LoadOPL4ROM(CHIP_DEVICE* chipDev)
 {
 	static const char* romFile = "yrw801.rom";
@@ -1713,6 +1812,8 @@ UINT32 VGMPlayer::Render(UINT32 smplCnt, WAVE_32BS* data)
 	UINT32 maxSmpl;
 	INT32 smplStep;	// might be negative due to rounding errors in Tick2Sample
 	size_t curDev;
+	bool profStep;
+	std::chrono::steady_clock::time_point profStart;
 	
 	// Note: use do {} while(), so that "smplCnt == 0" can be used to process until reaching the next sample.
 	curSmpl = 0;
@@ -1724,22 +1825,44 @@ UINT32 VGMPlayer::Render(UINT32 smplCnt, WAVE_32BS* data)
 		// render as many samples at once as possible (for better performance)
 		maxSmpl = Tick2Sample(_fileTick);
 		smplStep = maxSmpl - _playSmpl;
-		// When DAC streams are active, limit step size to 1, so that DAC streams and sound chip emulation are in sync.
-		if (smplStep < 1 || ! _dacStreams.empty())
+		if (smplStep < 1)
 			smplStep = 1;	// must render at least 1 sample in order to advance
+		// When DAC streams are active, stop before the next DAC stream command, so that DAC streams and sound chip emulation are in sync.
+		for (curDev = 0; curDev < _dacStreams.size(); curDev ++)
+		{
+			UINT32 dacSmpls = daccontrol_get_samples_until_cmd(_dacStreams[curDev].defInf.dataPtr);
+			if ((UINT32)smplStep > dacSmpls)
+				smplStep = dacSmpls;
+		}
 		if ((UINT32)smplStep > smplCnt - curSmpl)
 			smplStep = smplCnt - curSmpl;
 		
+		// When profiling, measure every 8th step. Reading the clock for every step would be too slow
+		// when rendering single samples.
+		profStep = _devProfiling && ! (_profStepCnt ++ & 0x07);
 		for (curDev = 0; curDev < _devices.size(); curDev ++)
 		{
 			CHIP_DEVICE* cDev = &_devices[curDev];
 			UINT8 disable = (cDev->optID != (size_t)-1) ? _devOpts[cDev->optID].muteOpts.disable : 0x00;
 			VGM_BASEDEV* clDev;
+			bool devRendered = false;
 			
+			if (profStep)
+				profStart = std::chrono::steady_clock::now();
 			for (clDev = &cDev->base; clDev != NULL; clDev = clDev->linkDev, disable >>= 1)
 			{
 				if (clDev->defInf.dataPtr != NULL && ! (disable & 0x01))
+				{
 					Resmpl_Execute(&clDev->resmpl, smplStep, &data[curSmpl]);
+					DevTap_Execute(clDev, smplStep, curSmpl);
+					devRendered = true;
+				}
+			}
+			if (profStep && devRendered)
+			{
+				std::chrono::nanoseconds profTime = std::chrono::steady_clock::now() - profStart;
+				cDev->profSmpls += smplStep;
+				cDev->profTime += profTime.count();
 			}
 		}
 		for (curDev = 0; curDev < _dacStreams.size(); curDev ++)
@@ -1769,6 +1892,20 @@ void VGMPlayer::ParseFile(UINT32 ticks)
 	while(_filePos < _fileHdr.dataEnd && _fileTick <= _playTick && ! (_playState & PLAYSTATE_END))
 	{
 		UINT8 curCmd = _fileData[_filePos];
+		// Delays make up most commands in a typical VGM, so decode them inline
+		// instead of calling through the command table.
+		if (curCmd >= 0x70 && curCmd <= 0x7F)
+		{
+			_fileTick += 1 + (curCmd & 0x0F);
+			_filePos ++;
+			continue;
+		}
+		else if (curCmd == 0x61)
+		{
+			_fileTick += ReadLE16(&_fileData[_filePos + 0x01]);
+			_filePos += 0x03;
+			continue;
+		}
 		COMMAND_FUNC func = _CMD_INFO[curCmd].func;
 		(this->*func)();
 		_filePos += _CMD_INFO[curCmd].cmdLen;
@@ -45,6 +45,9 @@ struct VGM_PLAY_OPTIONS
 	UINT32 playbackHz;	// set to 60 (NTSC) or 50 (PAL) for region-specific song speed adjustment
 						// Note: requires VGM_HEADER.recordHz to be non-zero to work.
 	UINT8 hardStopOld;	// enforce silence at end of old VGMs (<1.50), fixes Key Off events being trimmed off
+	UINT8 skipDisabledDevs;	// don't send register writes to devices disabled via PLR_MUTE_OPTS::disable,
+						// and don't start devices that are disabled (disable = 0xFF) when calling Start()
+						// Note: Devices miss all writes while disabled, so don't re-enable them during playback.
 };
 
 
@@ -64,6 +67,7 @@ public:
 		UINT8 chipID;
 		UINT32 flags;
 		size_t optID;
+		UINT8 disabled;	// set when the device and all its linked devices are disabled
 		DEVFUNC_WRITE_A8D8 write8;		// write 8-bit data to 8-bit register/offset
 		DEVFUNC_WRITE_A16D8 writeM8;	// write 8-bit data to 16-bit memory offset
 		DEVFUNC_WRITE_A8D16 writeD16;	// write 16-bit data to 8-bit register/offset
@@ -73,6 +77,8 @@ public:
 		DEVFUNC_WRITE_MEMSIZE romSizeB;
 		DEVFUNC_WRITE_BLOCK romWriteB;
 		DEVLOG_CB_DATA logCbData;
+		UINT64 profSmpls;	// device profiling: number of measured samples
+		UINT64 profTime;	// device profiling: emulation time in nanoseconds
 	};
 	struct DACSTRM_DEV
 	{
@@ -115,7 +121,9 @@ protected:
 	
 	struct PCM_BANK
 	{
-		std::vector<UINT8> data;
+		std::vector<UINT8> data;	// only used for banks that can't reference the file data directly
+		const UINT8* dataPtr;	// points to either &data[0] or into the file data
+		UINT32 dataSize;
 		std::vector<UINT32> bankOfs;
 		std::vector<UINT32> bankSize;
 	};
@@ -160,6 +168,9 @@ public:
 	UINT8 GetDeviceOptions(UINT32 id, PLR_DEV_OPTS& devOpts) const;
 	UINT8 SetDeviceMuting(UINT32 id, const PLR_MUTE_OPTS& muteOpts);
 	UINT8 GetDeviceMuting(UINT32 id, PLR_MUTE_OPTS& muteOpts) const;
+	UINT8 SetChannelTap(UINT32 id, UINT8 subChip, UINT8 chnID, WAVE_32BS* tapBuf);
+	UINT8 SetDeviceProfiling(UINT8 enable);
+	UINT8 GetDeviceProfiles(std::vector<PLR_DEV_PROFILE>& profList) const;
 	// player-specific options
 	UINT8 SetPlayerOptions(const VGM_PLAY_OPTIONS& playOpts);
 	UINT8 GetPlayerOptions(VGM_PLAY_OPTIONS& playOpts) const;
@@ -219,6 +230,8 @@ protected:
 	
 	static void DeviceLinkCallback(void* userParam, VGM_BASEDEV* cDev, DEVLINK_INFO* dLink);
 	CHIP_DEVICE* GetDevicePtr(UINT8 chipType, UINT8 chipID);
+	CHIP_DEVICE* GetWriteDevicePtr(UINT8 chipType, UINT8 chipID);	// returns NULL for skipped devices
+	UINT8 CanSkipDevice(UINT8 vgmChipType) const;
 	void LoadOPL4ROM(CHIP_DEVICE* chipDev);
 	
 	UINT8 SeekToTick(UINT32 tick);
@@ -329,6 +342,8 @@ protected:
 	
 	UINT8 _playState;
 	UINT8 _psTrigger;	// used to temporarily trigger special commands
+	UINT8 _devProfiling;	// device profiling: enable flag
+	UINT8 _profStepCnt;	// device profiling: counter for choosing which rendering steps to measure
 	//PLAYER_EVENT_CB _eventCbFunc;
 	//void* _eventCbParam;
 	//PLAYER_FILEREQ_CB _fileReqCbFunc;
@@ -354,6 +369,7 @@ protected:
 	size_t _optDevMap[_OPT_DEV_COUNT * 2];	// maps _devOpts vector index to _devices vector
 	std::vector<CHIP_DEVICE> _devices;
 	std::vector<std::string> _devNames;
+	UINT16 _skippedDevVol;	// volume of devices that weren't started due to skipDisabledDevs
 	
 	size_t _dacStrmMap[0x100];	// maps VGM DAC stream ID -> _dacStreams vector
 	std::vector<DACSTRM_DEV> _dacStreams;
@@ -705,7 +705,7 @@ void VGMPlayer::Cmd_DataBlock(void)
 		{
 			PCM_BANK* pcmBnk = &_pcmBank[dblkType & 0x3F];
 			PCM_CDB_INF dbCI;
-			UINT32 oldLen = (UINT32)pcmBnk->data.size();
+			UINT32 oldLen = pcmBnk->dataSize;
 			dataLen = dblkLen;
 			dataPtr = &fData[0x00];
 			
@@ -719,6 +719,17 @@ void VGMPlayer::Cmd_DataBlock(void)
 			pcmBnk->bankOfs.push_back(oldLen);
 			pcmBnk->bankSize.push_back(dataLen);
 			
+			if (! oldLen && ! (dblkType & 0x40))
+			{
+				// The file data stays loaded during playback, so a bank consisting of a single
+				// uncompressed block can use it in place. (The file data may be shared by multiple players.)
+				pcmBnk->dataPtr = dataPtr;
+				pcmBnk->dataSize = dataLen;
+				break;
+			}
+			if (pcmBnk->data.empty() && oldLen)
+				pcmBnk->data.assign(pcmBnk->dataPtr, pcmBnk->dataPtr + oldLen);	// copy the referenced block
+			
 			pcmBnk->data.resize(oldLen + dataLen);
 			if (dblkType & 0x40)
 			{
@@ -735,6 +746,8 @@ void VGMPlayer::Cmd_DataBlock(void)
 			{
 				memcpy(&pcmBnk->data[oldLen], dataPtr, dataLen);
 			}
+			pcmBnk->dataPtr = pcmBnk->data.empty() ? NULL : &pcmBnk->data[0];
+			pcmBnk->dataSize = (UINT32)pcmBnk->data.size();
 			
 			// TODO: refresh DAC Stream pointers (call daccontrol_refresh_data)
 		}
@@ -803,16 +816,16 @@ void VGMPlayer::Cmd_PcmRamWrite(void)
 	
 	UINT8 chipType = _VGM_BANK_CHIPS[dbType];
 	UINT8 chipID = (fData[0x02] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->romWrite == NULL)
 		return;
 	
 	UINT32 dbPos = ReadLE24(&fData[0x03]);
 	UINT32 wrtAddr = ReadLE24(&fData[0x06]);
 	UINT32 dataLen = ReadLE24(&fData[0x09]);
-	if (dbPos >= _pcmBank[dbType].data.size())
+	if (dbPos >= _pcmBank[dbType].dataSize)
 		return;
-	const UINT8* ROMData = &_pcmBank[dbType].data[dbPos];
+	const UINT8* ROMData = &_pcmBank[dbType].dataPtr[dbPos];
 	if (! dataLen)
 		dataLen += 0x01000000;
 	
@@ -830,15 +843,15 @@ void VGMPlayer::Cmd_PcmRamWrite(void)
 
 void VGMPlayer::Cmd_YM2612PCM_Delay(void)
 {
-	CHIP_DEVICE* cDev = GetDevicePtr(0x02, 0);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(0x02, 0);
 	_fileTick += (fData[0x00] & 0x0F);
 	
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
-	if (_ym2612pcm_bnkPos >= _pcmBank[0].data.size())
+	if (_ym2612pcm_bnkPos >= _pcmBank[0].dataSize)
 		return;
 	
-	UINT8 data = _pcmBank[0].data[_ym2612pcm_bnkPos];
+	UINT8 data = _pcmBank[0].dataPtr[_ym2612pcm_bnkPos];
 	SendYMCommand(cDev, 0x00, 0x2A, data);
 	_ym2612pcm_bnkPos ++;
 	// TODO: clip when exceeding pcmBank size
@@ -911,7 +924,7 @@ void VGMPlayer::Cmd_DACCtrl_SetData(void)	// DAC Stream Control: Set Data Bank
 	PCM_BANK* pcmBnk = &_pcmBank[dacStrm->bankID];
 	
 	dacStrm->maxItems = (UINT32)pcmBnk->bankOfs.size();
-	daccontrol_set_data(dacStrm->defInf.dataPtr, &pcmBnk->data[0], (UINT32)pcmBnk->data.size(), fData[0x03], fData[0x04]);
+	daccontrol_set_data(dacStrm->defInf.dataPtr, pcmBnk->dataPtr, pcmBnk->dataSize, fData[0x03], fData[0x04]);
 	return;
 }
 
@@ -993,7 +1006,7 @@ void VGMPlayer::Cmd_GGStereo(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x00] == 0x3F) ? 1 : 0;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1005,7 +1018,7 @@ void VGMPlayer::Cmd_SN76489(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x00] == 0x30) ? 1 : 0;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1017,7 +1030,7 @@ void VGMPlayer::Cmd_Reg8_Data8(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x00] >= 0xA0) ? 1 : 0;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1029,7 +1042,7 @@ void VGMPlayer::Cmd_CPort_Reg8_Data8(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x00] >= 0xA0) ? 1 : 0;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1041,7 +1054,7 @@ void VGMPlayer::Cmd_Port_Reg8_Data8(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1053,7 +1066,7 @@ void VGMPlayer::Cmd_Ofs8_Data8(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1065,7 +1078,7 @@ void VGMPlayer::Cmd_Ofs16_Data8(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->writeM8 == NULL)
 		return;
 	
@@ -1078,7 +1091,7 @@ void VGMPlayer::Cmd_Ofs8_Data16(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->writeD16 == NULL)
 		return;
 	
@@ -1091,7 +1104,7 @@ void VGMPlayer::Cmd_Ofs16_Data16(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->writeM16 == NULL)
 		return;
 	
@@ -1105,7 +1118,7 @@ void VGMPlayer::Cmd_Port_Ofs8_Data8(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1117,7 +1130,7 @@ void VGMPlayer::Cmd_DReg8_Data8(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1129,7 +1142,7 @@ void VGMPlayer::Cmd_SegaPCM_Mem(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x02] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->writeM8 == NULL)
 		return;
 	
@@ -1142,7 +1155,7 @@ void VGMPlayer::Cmd_RF5C_Mem(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = 0;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->writeM8 == NULL)
 		return;
 	
@@ -1157,7 +1170,7 @@ void VGMPlayer::Cmd_RF5C_Reg(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1178,7 +1191,7 @@ void VGMPlayer::Cmd_PWM_Reg(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = 0;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->writeD16 == NULL)
 		return;
 	
@@ -1192,7 +1205,7 @@ void VGMPlayer::Cmd_QSound_Reg(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = 0;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	QSOUND_WORK* qsWork = &_qsWork[chipID];
 	if (cDev == NULL || qsWork->write == NULL)
 		return;
@@ -1250,7 +1263,7 @@ void VGMPlayer::Cmd_WSwan_Reg(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1262,7 +1275,7 @@ void VGMPlayer::Cmd_NES_Reg(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1282,7 +1295,7 @@ void VGMPlayer::Cmd_YMW_Bank(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1309,7 +1322,7 @@ void VGMPlayer::Cmd_SAA_Reg(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1322,7 +1335,7 @@ void VGMPlayer::Cmd_OKIM6295_Reg(void)
 {
 	UINT8 chipType = _CMD_INFO[fData[0x00]].chipType;
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -1346,7 +1359,7 @@ void VGMPlayer::Cmd_AY_Stereo(void)
 {
 	UINT8 chipType = (fData[0x01] & 0x40) ? 0x06 : 0x12;	// YM2203 SSG or AY8910
 	UINT8 chipID = (fData[0x01] & 0x80) >> 7;
-	CHIP_DEVICE* cDev = GetDevicePtr(chipType, chipID);
+	CHIP_DEVICE* cDev = GetWriteDevicePtr(chipType, chipID);
 	if (cDev == NULL || cDev->write8 == NULL)
 		return;
 	
@@ -11,8 +11,10 @@ UINT8 DataLoader_Reset(DATA_LOADER *loader)
 	DataLoader_CancelLoading(loader);
 
 	if(loader->_data) {
-		free(loader->_data);
+		if(! loader->_dataIsRef)
+			free(loader->_data);
 		loader->_data = NULL;
+		loader->_dataIsRef = 0;
 		loader->_bytesLoaded = 0;
 	}
 
@@ -68,6 +70,23 @@ UINT8 DataLoader_Load(DATA_LOADER *loader)
 	return 0x00;
 }
 
+UINT8 DataLoader_LoadRef(DATA_LOADER *loader, const UINT8 *data, UINT32 length)
+{
+	if (loader->_status == DLSTAT_LOADING)
+		return 0x01;
+
+	DataLoader_Reset(loader);
+
+	// The data is never written to, as DataLoader_Read stops once the status is "loaded".
+	loader->_data = (UINT8 *)data;
+	loader->_dataIsRef = 1;
+	loader->_bytesTotal = length;
+	loader->_bytesLoaded = length;
+	loader->_status = DLSTAT_LOADED;
+
+	return 0x00;
+}
+
 void DataLoader_SetPreloadBytes(DATA_LOADER *loader, UINT32 byteCount)
 {
 	loader->_readStopOfs = byteCount;
@@ -139,6 +158,7 @@ void DataLoader_Deinit(DATA_LOADER *dLoader)
 
 void DataLoader_Setup(DATA_LOADER *loader, const DATA_LOADER_CALLBACKS *callbacks, void *context) {
 	loader->_data = NULL;
+	loader->_dataIsRef = 0;
 	loader->_status = DLSTAT_EMPTY;
 	loader->_readStopOfs = (UINT32)-1;
 	loader->_context = context;
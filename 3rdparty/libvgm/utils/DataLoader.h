@@ -42,6 +42,7 @@ typedef struct _data_loader
 	UINT32 _bytesLoaded;
 	UINT32 _readStopOfs;
 	UINT8 *_data;
+	UINT8 _dataIsRef;	/* _data points to memory owned by the caller (see DataLoader_LoadRef) */
 	const DATA_LOADER_CALLBACKS *_callbacks;
 	void *_context;
 } DATA_LOADER;
@@ -51,6 +52,11 @@ typedef struct _data_loader
  * DataLoader_SetPreloadBytes to change this */
 UINT8 DataLoader_Load(DATA_LOADER *loader);
 
+/* makes the DataLoader use already loaded (decompressed) data without copying it,
+ * instead of calling dopen/dread
+ * The data must stay valid and unchanged until the DataLoader is reset. */
+UINT8 DataLoader_LoadRef(DATA_LOADER *loader, const UINT8 *data, UINT32 length);
+
 /* Resets the DataLoader (calls DataReader_CancelLoading, unloads data, etc */
 UINT8 DataLoader_Reset(DATA_LOADER *loader);
 
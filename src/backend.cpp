@@ -1,6 +1,6 @@
 #include "backend.h"
-#include "mainwindow.h"
 #include "lib/box_array.h"
+#include "lib/defer.h"
 #include "lib/enumerate.h"
 #include "lib/format.h"
 #include "lib/release_assert.h"
@@ -17,11 +17,14 @@
 #include <player/s98player.hpp>
 #include <player/droplayer.hpp>
 #include <player/gymplayer.hpp>
+#include <emu/EmuCores.h>
 #include <emu/SoundDevs.h>
 #include <emu/SoundEmu.h>
+#include <emu/cores/2612intf.h>  // OPT_YM2612_SKIP_MUTED_EG
 
 #include <stx/result.h>
 
+#include <QCryptographicHash>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
@@ -32,10 +35,16 @@
 #include <QThreadPool>
 
 #include <atomic>
-#include <algorithm>  // std::stable_sort
+#include <algorithm>  // std::stable_sort, std::all_of, std::remove_if
+#include <climits>  // INT_MAX
+#include <cmath>
+#include <condition_variable>
 #include <cstdint>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <optional>
+#include <tuple>
 #include <unordered_map>
 
 //#define BACKEND_DEBUG
@@ -44,11 +53,19 @@ using std::move;
 using stx::Result, stx::Ok, stx::Err;
 using format::format_hex_2;
 
-using Amplitude = int16_t;
-static constexpr uint8_t BIT_DEPTH = 16;
 static constexpr uint32_t BUFFER_LEN = 2048;
 static constexpr uint32_t CHANNEL_COUNT = 2;
 
+/// Returns the bit depth passed to PlayerA::SetOutputSettings().
+static uint8_t player_sample_bits(SampleFormat format) {
+    switch (format) {
+    case SampleFormat::Int16: return 16;
+    case SampleFormat::Int24: return 24;
+    case SampleFormat::Float32: return 32 | PLR_SMPL_FLOAT;
+    }
+    return 16;
+}
+
 struct DeleteDataLoader {
     void operator()(DATA_LOADER * obj) {
         // DataLoader_Deinit has this check too, but this check can be inlined,
@@ -62,6 +79,53 @@ struct DeleteDataLoader {
 
 using BoxDataLoader = std::unique_ptr<DATA_LOADER, DeleteDataLoader>;
 
+/// Reads the entire file, and decompresses it if it's gzipped (.vgz).
+/// The result is stored in Backend and shared by all players loading the song.
+static Result<QByteArray, QString> decompress_song(QByteArray const& file_data) {
+    UINT8 status;
+
+    auto loader = BoxDataLoader(MemoryLoader_Init(
+        (UINT8 const*) file_data.data(), (UINT32) file_data.size()
+    ));
+    if (loader == nullptr) {
+        return Err(Backend::tr("Failed to allocate MemoryLoader_Init"));
+    }
+
+    // DataLoader_Load() reads the whole file unless DataLoader_SetPreloadBytes() is
+    // called.
+    status = DataLoader_Load(loader.get());
+    if (status) {
+        // BoxDataLoader calls DataLoader_Deinit upon destruction.
+        // It seems DataLoader_Deinit calls DataLoader_Reset, which calls
+        // DataLoader_CancelLoading. So we don't need to explicitly call
+        // DataLoader_CancelLoading beforehand, and IDK why player.cpp does so.
+        return Err(Backend::tr("Failed to extract file, error 0x%1")
+            .arg(format_hex_2(status)));
+    }
+
+    return Ok(QByteArray(
+        (char const*) DataLoader_GetData(loader.get()),
+        (int) DataLoader_GetSize(loader.get())
+    ));
+}
+
+/// Creates a DataLoader which points within song_data (SongData::bytes returned by
+/// read_song()) without copying or decompressing it. song_data must outlive
+/// the DataLoader.
+static Result<BoxDataLoader, QString> load_song(QByteArray const& song_data) {
+    auto loader = BoxDataLoader(MemoryLoader_Init(
+        (UINT8 const*) song_data.data(), (UINT32) song_data.size()
+    ));
+    if (loader == nullptr) {
+        return Err(Backend::tr("Failed to allocate MemoryLoader_Init"));
+    }
+
+    DataLoader_LoadRef(
+        loader.get(), (UINT8 const*) song_data.data(), (UINT32) song_data.size()
+    );
+    return Ok(move(loader));
+}
+
 static bool compare_chips(PLR_DEV_INFO const& a, PLR_DEV_INFO const& b) {
     static constexpr auto key = [](uint8_t type) -> int {
         // Order PSG after YM2612. Keep PSG before 32X, because base console chips
@@ -89,37 +153,39 @@ struct Metadata {
     std::vector<ChipMetadata> chips;
     std::vector<FlatChannelMetadata> flat_channels;
 
+    /// The sampling rate of the first chip (in sort_chips() order) running at up to
+    /// 100 KHz, or 0 if there is none. Read once when loading the file, so changing
+    /// settings doesn't reload it.
+    uint32_t chip_sample_rate;
+
     uint32_t sample_rate;
 
-    /// Master audio renders more slowly than individual channels, so make it take up
-    /// more space in the overall progress bar.
-    float master_audio_time_multiplier;
+    /// The following fields are used to estimate how much memory a render takes.
+
+    /// Estimated bytes each player allocates for the song's data blocks (PCM data and
+    /// chip ROMs), 0 if the format has none.
+    uint64_t data_block_bytes;
+
+    /// Length of the song played once, in seconds.
+    double song_seconds;
+
+    /// Length of one pass through the song's loop, in seconds, 0 if unlooped.
+    double loop_seconds;
 
 // impl
 public:
-    /// Calls load_settings().
+    /// Loads the file once, and calls load_settings(). song_data is SongData::bytes
+    /// returned by read_song().
     static Result<std::unique_ptr<Metadata>, QString> make(
-        QByteArray file_data, AppSettings const& app
+        QByteArray const& song_data, AppSettings const& app
     ) {
         UINT8 status;
 
-        auto loader = BoxDataLoader(MemoryLoader_Init(
-            (UINT8 const*) file_data.data(), (UINT32) file_data.size()
-        ));
-        if (loader == nullptr) {
-            return Err(Backend::tr("Failed to allocate MemoryLoader_Init"));
-        }
-
-        DataLoader_SetPreloadBytes(loader.get(), 0x100);
-        status = DataLoader_Load(loader.get());
-        if (status) {
-            // BoxDataLoader calls DataLoader_Deinit upon destruction.
-            // It seems DataLoader_Deinit calls DataLoader_Reset, which calls
-            // DataLoader_CancelLoading. So we don't need to explicitly call
-            // DataLoader_CancelLoading beforehand, and IDK why player.cpp does so.
-            return Err(Backend::tr("Failed to extract file, error 0x%1")
-                .arg(format_hex_2(status)));
+        auto maybe_loader = load_song(song_data);
+        if (maybe_loader.is_err()) {
+            return Err(move(maybe_loader.err_value()));
         }
+        auto loader = move(maybe_loader.value());
 
         auto player = std::make_unique<PlayerA>();
         /* Register all player engines.
@@ -135,12 +201,29 @@ public:
                 .arg(format_hex_2(status)));
         }
 
+        // Start the player, so GetSongDeviceInfo() returns each chip's emulation core
+        // and sampling rate (used to estimate rendering time, and to pick the output
+        // sampling rate).
+        player->Start();
+
         std::vector<PLR_DEV_INFO> devices;
 
         PlayerBase * engine = player->GetPlayer();
         engine->GetSongDeviceInfo(devices);
         sort_chips(devices);
 
+        // Find channels which the song never uses, so they're skipped by default.
+        std::map<uint32_t, ChipActivity> activity;
+        uint64_t data_block_bytes = 0;
+        if (engine->GetPlayerType() == FCC_VGM) {
+            activity = scan_vgm_activity(
+                (uint8_t const*) song_data.constData(),
+                (size_t) song_data.size(),
+                devices);
+            data_block_bytes = vgm_data_block_bytes(
+                (uint8_t const*) song_data.constData(), (size_t) song_data.size());
+        }
+
         std::vector<ChipMetadata> chips;
         std::vector<FlatChannelMetadata> flat_channels = {
             FlatChannelMetadata {
@@ -148,6 +231,7 @@ public:
                 .maybe_chip_id = NO_CHIP,
                 .subchip_idx = 0,
                 .chan_idx = 0,
+                .activity = ChannelActivity::Active,
                 .enabled = true,
             }
         };
@@ -164,58 +248,64 @@ public:
 
             ChipId chip_id =
                 PLR_DEV_ID((uint32_t) device.type, (uint32_t) device.instance);
+            auto chip_channels = get_chip_metadata(device, show_chip_name);
+
             chips.push_back(ChipMetadata {
                 .name = chipName,
                 .chip_id = chip_id,
+                .type = device.type,
+                .core = device.core,
+                .sample_rate = device.smplRate,
+                .nchan = (uint32_t) chip_channels.size(),
             });
 
-            for (
-                ChannelMetadata & channel :
-                get_chip_metadata(device, show_chip_name)
-            ) {
+            auto chip_activity = activity.find(chip_id);
+            for (ChannelMetadata & channel : chip_channels) {
+                auto channel_activity = ChannelActivity::Unknown;
+                if (chip_activity != activity.end()) {
+                    uint32_t active = chip_activity->second.active[channel.subchip_idx];
+                    channel_activity = (active >> channel.chan_idx) & 1
+                        ? ChannelActivity::Active
+                        : ChannelActivity::Silent;
+                }
+
                 flat_channels.push_back(FlatChannelMetadata {
                     .name = move(channel.name),
                     .maybe_chip_id = chip_id,
                     .subchip_idx = channel.subchip_idx,
                     .chan_idx = channel.chan_idx,
-                    .enabled = true,
+                    .activity = channel_activity,
+                    .enabled = channel_activity != ChannelActivity::Silent,
                 });
             }
         }
 
-        /*
-        Calculate master_audio_time_multiplier based off the total number of channels,
-        not the number of channels enabled in a particular render.
-
-        In my testing with OPL3 and 32X .vgm files, rendering the master audio takes
-        around (total channels / 2) as long as rendering a single channel.
-
-        In Master System SN76489-like .vgm files, rendering the master audio is no
-        slower than a single channel, so this calculation is wrong. But it's not a big
-        deal, since Master System .vgm files render quickly, and have ≤ channels than
-        most people have CPU cores.
-        */
-        float master_audio_time_multiplier =
-            std::max(1.f, (float) flat_channels.size() / 2.f);
+        // Avoid writing WAV files with sampling rates above 100 KHz.
+        //
+        // TODO add an alternative mode for recording each channel with its
+        // exact sampling rate (except that 32X has variable sampling rate)?
+        //
+        // TODO add a setting toggle/integer for "maximum sampling rate to
+        // auto-detect"?
+        uint32_t chip_sample_rate = 0;
+        for (PLR_DEV_INFO const& device : devices) {
+            if (device.smplRate <= 100'000) {
+                chip_sample_rate = device.smplRate;
+                break;
+            }
+        }
 
         auto out = std::make_unique<Metadata>(Metadata {
             .player_type = engine->GetPlayerType(),
             .chips = move(chips),
             .flat_channels = move(flat_channels),
+            .chip_sample_rate = chip_sample_rate,
             .sample_rate = 0,
-            .master_audio_time_multiplier = master_audio_time_multiplier,
+            .data_block_bytes = data_block_bytes,
+            .song_seconds = engine->Tick2Second(engine->GetTotalTicks()),
+            .loop_seconds = engine->Tick2Second(engine->GetLoopTicks()),
         });
-        // Destroy the PlayerA object before loading settings, to reduce peak RAM usage.
-        player.reset();
-
-        // This constructs a new PlayerA object. This is slower than optimal, but
-        // avoids separate codepaths for loading a file, and changing settings after
-        // opening a file, which may behave differently.
-        auto err = out->load_settings(file_data, app);
-        if (!err.isEmpty()) {
-            return Err(move(err));
-        }
-
+        out->load_settings(app);
         return Ok(move(out));
     }
 
@@ -223,90 +313,15 @@ public:
         return this->player_type != 0;
     }
 
-    /// If non-empty, holds error message.
-    [[nodiscard]] QString load_settings(
-        QByteArray const& file_data, AppSettings const& app
-    ) {
-        // Set this->sample_rate.
+    /// Sets sample_rate from the app settings, without reloading the file.
+    void load_settings(AppSettings const& app) {
         if (!is_file_loaded()) {
             this->sample_rate = 0;
-        } else if (app.use_chip_rate) {
-            PlayerA player;
-
-            std::unique_ptr<PlayerBase> engine_move;
-
-            switch (player_type) {
-            case FCC_VGM: engine_move = std::make_unique<VGMPlayer>(); break;
-            case FCC_S98: engine_move = std::make_unique<S98Player>(); break;
-            case FCC_DRO: engine_move = std::make_unique<DROPlayer>(); break;
-            case FCC_GYM: engine_move = std::make_unique<GYMPlayer>(); break;
-            default:
-                return Backend::tr("Failed to load settings, unrecognized file type 0x%1")
-                    .arg(QString::number(player_type, 16).toUpper());
-            }
-
-            UINT8 status;
-
-            auto loader = BoxDataLoader(MemoryLoader_Init(
-                (UINT8 const*) file_data.data(), (UINT32) file_data.size()
-            ));
-            if (loader == nullptr) {
-                return Backend::tr("Failed to allocate MemoryLoader_Init");
-            }
-
-            DataLoader_SetPreloadBytes(loader.get(), 0x100);
-            status = DataLoader_Load(loader.get());
-            if (status) {
-                return Backend::tr("Failed to extract file, error 0x%1")
-                    .arg(format_hex_2(status));
-            }
-
-            // Register the correct playback engine. This saves memory compared to
-            // creating 4 different engines for each channel in the file.
-            player.RegisterPlayerEngine(engine_move.release());
-
-            // Load the file using the playback engine.
-            status = player.LoadFile(loader.get());
-            if (status) {
-                return Backend::tr("Failed to load file, error 0x%1")
-                    .arg(format_hex_2(status));
-            }
-            player.Start();
-
-            PlayerBase * engine = player.GetPlayer();
-            std::vector<PLR_DEV_INFO> devices;
-            engine->GetSongDeviceInfo(devices);
-            sort_chips(devices);
-
-#ifdef BACKEND_DEBUG
-            for (PLR_DEV_INFO const& device : devices) {
-                qDebug() << device.smplRate;
-            }
-#endif
-
-            bool done = false;
-            for (PLR_DEV_INFO const& device : devices) {
-                // Avoid writing WAV files with sampling rates above 100 KHz.
-                //
-                // TODO add an alternative mode for recording each channel with its
-                // exact sampling rate (except that 32X has variable sampling rate)?
-                //
-                // TODO add a setting toggle/integer for "maximum sampling rate to
-                // auto-detect"?
-                if (device.smplRate <= 100'000) {
-                    this->sample_rate = device.smplRate;
-                    done = true;
-                    break;
-                }
-            }
-            if (!done) {
-                this->sample_rate = app.sample_rate;
-            }
+        } else if (app.use_chip_rate && this->chip_sample_rate) {
+            this->sample_rate = this->chip_sample_rate;
         } else {
             this->sample_rate = app.sample_rate;
         }
-
-        return QString();
     }
 };
 
@@ -336,11 +351,34 @@ struct SoloSettings {
     uint8_t chan_idx;
 };
 
+/// Returns the muting of a chip in a job rendering only solo's channel. Other chips
+/// and subchips are disabled (so they aren't emulated), and other channels muted.
+static PLR_MUTE_OPTS solo_mute_opts(ChipMetadata const& chip, SoloSettings const& solo) {
+    PLR_MUTE_OPTS mute{};
+    if (chip.chip_id != solo.chip_id) {
+        mute.disable = 0xff;
+        mute.chnMute[0] = mute.chnMute[1] = ~0u;
+        return mute;
+    }
+    for (size_t subchip_idx = 0; subchip_idx < 2; subchip_idx++) {
+        if (subchip_idx != solo.subchip_idx) {
+            mute.disable |= (uint8_t) (1 << subchip_idx);
+            mute.chnMute[subchip_idx] = ~0u;
+        } else {
+            mute.chnMute[subchip_idx] = (~0u) ^ (1 << solo.chan_idx);
+        }
+    }
+    return mute;
+}
+
 struct RenderSettings {
     std::optional<SoloSettings> solo;
 
     uint32_t sample_rate;
 
+    /// See RenderOptions::format.
+    SampleFormat format = SampleFormat::Int16;
+
     /// Q15.16 signed floating point value. 0x1'0000 is 100% volume.
     int32_t volume = 0x1'0000;
 
@@ -351,28 +389,348 @@ struct RenderSettings {
     /// How long to keep playing after the last command, for unlooped songs. In seconds.
     float unlooped_tail = 1.0;
 
+    /// See RenderOptions::copy_loops.
+    bool copy_loops = false;
+
     // TODO duration override?
 };
 
-struct RenderJobState {
+/// Until a sound core's speed has been measured, assume that emulating one second of
+/// audio takes this long (in seconds of CPU time) per chip channel.
+static constexpr double FALLBACK_CHANNEL_COST = 0.002;
+
+/// Estimates the CPU time (in seconds) needed to emulate one second of a chip.
+static double chip_cost(Settings const& settings, ChipMetadata const& chip, bool solo) {
+    if (chip.core != 0 && chip.sample_rate != 0) {
+        if (auto speed = settings.core_speed(chip.type, chip.core, solo)) {
+            return (double) chip.sample_rate / *speed;
+        }
+    }
+
+    // In my testing with OPL3 and 32X .vgm files, rendering the master audio takes
+    // around (total channels / 2) as long as rendering a single channel. This isn't
+    // true for every core (eg. SN76489), which is why we measure speed instead.
+    auto nchan = (double) std::max(chip.nchan, 1u);
+    double cost = FALLBACK_CHANNEL_COST * nchan;
+    if (solo) {
+        cost *= std::min(1., 2. / nchan);
+    }
+    return cost;
+}
+
+/// Estimates the CPU time (in seconds) needed to render one second of a job.
+/// Solo jobs only emulate the soloed chip.
+static double job_cost(
+    Settings const& settings,
+    Metadata const& metadata,
+    std::optional<SoloSettings> const& solo)
+{
+    double cost = 0;
+    for (ChipMetadata const& chip : metadata.chips) {
+        if (!solo) {
+            cost += chip_cost(settings, chip, false);
+        } else if (chip.chip_id == solo->chip_id) {
+            cost += chip_cost(settings, chip, true);
+        }
+    }
+    return cost;
+}
+
+/// Returns whether a chip's output equals the sum of its soloed channels (up to
+/// rounding), so master audio can be summed from channel outputs
+/// (RenderOptions::master_from_stems). Only lists cores measured by comparing a chip's
+/// output against the sum of its channels. Other cores (like YMF262, whose sum is
+/// far off) are assumed to mix nonlinearly.
+static bool mixes_linearly(ChipMetadata const& chip) {
+    switch (chip.type) {
+    case DEVID_SN76496:
+    case DEVID_YM2151:
+    case DEVID_YM2203:
+    case DEVID_YM2608:
+        return chip.core == FCC_MAME;
+    case DEVID_YM2612:
+        return chip.core == FCC_GPGX;
+    case DEVID_YM3812:
+        return chip.core == FCC_ADLE;
+    case DEVID_AY8910:
+        return chip.core == FCC_EMU_;
+    default:
+        return false;
+    }
+}
+
+/// Emulation speed of a sound core, measured while rendering.
+struct CoreTiming {
+    uint8_t type;
+    uint32_t core;
+    bool solo;
+    double chip_samples;
+    double seconds;
+};
+
+/// Collects CoreTiming from render jobs (on worker threads), until
+/// Backend::save_render_timings() saves them to settings.
+struct TimingLog {
+    std::mutex mutex;
+    std::vector<CoreTiming> timings;
+};
+
+/// Estimated memory used by each render job's player and sample buffers, excluding
+/// chips and the song data.
+static constexpr int64_t JOB_MEMORY = 1 << 20;
+/// Estimated memory used by each chip a render job creates (emulator state and
+/// resampling buffers).
+static constexpr int64_t CHIP_MEMORY = 256 << 10;
+/// Estimated memory used by each output file (mostly Wave_Writer's queued writes).
+static constexpr int64_t OUTPUT_MEMORY = 4 << 20;
+
+/// Estimated memory used by a render job's player, excluding the song data (which is
+/// shared between jobs) and outputs. Each player copies the song's data blocks.
+static int64_t player_memory(Metadata const& metadata) {
+    return JOB_MEMORY
+        + CHIP_MEMORY * (int64_t) metadata.chips.size()
+        + (int64_t) metadata.data_block_bytes;
+}
+
+/// Limits the estimated memory used by queued and active render jobs in
+/// Backend::render_batch(). Each job releases its share of the budget when finished.
+struct MemoryBudget {
+    std::mutex mutex;
+    std::condition_variable cv;
+    int64_t capacity;
+    int64_t used = 0;
+
+    explicit MemoryBudget(int64_t capacity)
+        : capacity(capacity)
+    {}
+
+    /// Waits until bytes fit in the budget, then reserves them. If nothing else holds
+    /// memory, always succeeds, even if bytes exceeds capacity.
+    void acquire(int64_t bytes) {
+        auto lock = std::unique_lock(mutex);
+        cv.wait(lock, [&] { return used == 0 || used + bytes <= capacity; });
+        used += bytes;
+    }
+
+    void release(int64_t bytes) {
+        adjust(-bytes);
+    }
+
+    /// Reserves bytes (or releases them if negative) without waiting.
+    void adjust(int64_t bytes) {
+        {
+            auto lock = std::lock_guard(mutex);
+            used += bytes;
+        }
+        cv.notify_all();
+    }
+};
+
+/// One .wav file written by a RenderJob.
+struct RenderOutput {
     /// Only shown for debugging purposes.
-    QString _name;
+    QString name;
+
+    QString path;
+
+    /// If set, holds the index of the PlayerA channel tap to write. Otherwise this
+    /// output holds the player's regular (mixed) output.
+    std::optional<size_t> tap_idx;
+
+    /// If tap_idx is set, the channel being tapped.
+    std::optional<SoloSettings> tap_channel;
+
+    /// If non-empty, the finished file is stored in the render cache under this key.
+    QByteArray cache_key;
+
+    /// If set, the finished file is deleted if every sample is zero.
+    bool drop_if_silent = false;
+
+    /// Set if the file was deleted because of drop_if_silent.
+    std::shared_ptr<std::atomic<bool>> dropped = std::make_shared<std::atomic<bool>>(false);
+
+    // TODO use something other than QFuture with richer progress info?
+    QFutureInterface<QString> status{};
+};
+
+/// When rendering a time segment of a song, start emulating this many seconds early
+/// (discarding the audio), so notes and envelopes started before the segment sound
+/// mostly the same as in an unsplit render.
+static constexpr uint32_t SEGMENT_WARMUP_SECONDS = 5;
+
+/// Don't split jobs into segments shorter than this, since each segment spends extra
+/// time on warm-up.
+static constexpr uint32_t MIN_SEGMENT_SECONDS = 30;
+
+/// Shared by the jobs rendering consecutive time segments of the same outputs
+/// (RenderOptions::split_long_jobs). Each job writes its segment into the same files,
+/// and the last job to finish writes the file headers and reports the outputs as
+/// finished.
+struct SegmentGroup {
+    /// Segment i renders frames [bounds[i], bounds[i + 1]), except that the last
+    /// segment renders until the song ends.
+    std::vector<uint32_t> bounds;
+
+    std::mutex mutex;
+    /// Seconds of audio rendered by each segment.
+    std::vector<int> progress;
+    /// Frames rendered by each finished segment.
+    std::vector<uint64_t> nframes;
+    /// Number of segments which haven't finished.
+    size_t nremaining;
+
+    explicit SegmentGroup(std::vector<uint32_t> bounds_)
+        : bounds(move(bounds_))
+        , progress(bounds.size() - 1)
+        , nframes(bounds.size() - 1)
+        , nremaining(bounds.size() - 1)
+    {}
+
+    size_t size() const {
+        return bounds.size() - 1;
+    }
+};
+
+class RenderJob;
+
+/// Master audio summed from the outputs of the jobs rendering each channel
+/// (RenderOptions::master_from_stems), rather than rendered by a job emulating every
+/// chip. Each contributing job adds its player's (mixed) output to sum, and the last
+/// job to finish writes the master file.
+struct StemMix {
+    /// The master audio file. The sum differs from a full render by rounding, so
+    /// cache_key is only used if the fallback job renders master audio.
+    RenderOutput output;
+
+    /// Creates a job which renders master audio as usual, if a contributing job
+    /// clipped or failed to finish (so the sum doesn't match master audio).
+    std::function<Result<std::unique_ptr<RenderJob>, QString>()> make_fallback;
+
+    /// Runs the fallback job. Set when the contributing jobs are started.
+    QThreadPool * pool = nullptr;
+
+    std::mutex mutex;
+    /// Interleaved stereo samples, summed from every contributing job.
+    std::vector<int32_t> sum;
+    /// Whether any contributing job's output was clipped.
+    bool clipped = false;
+    /// Seconds of audio rendered by each contributing job.
+    std::vector<int> progress;
+    /// Frames rendered by each finished contributing job.
+    std::vector<uint64_t> nframes;
+    /// Number of contributing jobs which haven't finished.
+    size_t nremaining;
+
+    explicit StemMix(RenderOutput output_, size_t ncontrib)
+        : output(move(output_))
+        , progress(ncontrib)
+        , nframes(ncontrib)
+        , nremaining(ncontrib)
+    {}
+};
+
+/// Where a looped song passes through its loop, in frames
+/// (RenderOptions::copy_loops).
+struct LoopBounds {
+    /// Where the first pass through the loop begins.
+    uint32_t begin;
+    /// The length of each pass.
+    uint32_t length;
+    /// Number of passes before the song fades out. At least 3.
+    uint32_t count;
+};
+
+/// Mixes bytes into a 64-bit FNV-1a hash. Used to compare passes through a song's
+/// loop without keeping them in memory.
+static uint64_t hash_bytes(uint64_t hash, uint8_t const* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100'0000'01b3;
+    }
+    return hash;
+}
+
+static constexpr uint64_t HASH_INIT = 0xcbf2'9ce4'8422'2325;
+
+/// Holds BUFFER_LEN frames of audio in any SampleFormat.
+using OutputBuffer = BoxArray<uint8_t, BUFFER_LEN * CHANNEL_COUNT * MAX_SAMPLE_SIZE>;
 
-    QString _out_path;
+/// The settings used to create a render job's player once the job runs
+/// (RenderJob::make_deferred()).
+struct DeferredPlayer {
+    std::shared_ptr<Metadata const> metadata;
+    RenderSettings settings;
+};
 
+struct RenderJobState {
+    /// Estimated CPU time (in seconds) to emulate one second of audio.
+    /// Split evenly between all outputs.
     float _time_multiplier;
 
-    /// Implicitly shared, read-only.
-    QByteArray _file_data;
+    /// If set, all but one channel is muted.
+    std::optional<SoloSettings> _solo;
+
+    /// Receives the measured speed of each sound core.
+    std::shared_ptr<TimingLog> _timings;
+
+    /// Song duration in seconds, used as the progress range of every output.
+    int _duration;
+
+    /// Song duration in frames, used to preallocate output files.
+    uint32_t _render_nsamp;
+
+    /// Sampling rate of the player's output.
+    uint32_t _sample_rate;
+
+    /// Estimated memory used by the player, returned by player_memory().
+    int64_t _player_memory;
+
+    /// Format of rendered samples and output files.
+    SampleFormat _format;
 
-    /// Points within _file_data, unique per job.
+    /// If set, passes through the loop after the second are copied (rather than
+    /// emulated) if the first two passes are identical.
+    std::optional<LoopBounds> _loop;
+
+    /// Decompressed song, shared between all jobs, read-only.
+    SongData _song_data;
+
+    /// Points within _song_data (without copying it), unique per job.
     BoxDataLoader _loader;
 
     std::unique_ptr<PlayerA> _player;
-    BoxArray<Amplitude, BUFFER_LEN * CHANNEL_COUNT> _buffer = {};
 
-    // TODO use something other than QFuture with richer progress info?
-    QFutureInterface<QString> _status{};
+    /// If set, _loader and _player are null until run() creates them, so setting up
+    /// jobs overlaps with rendering earlier jobs.
+    std::optional<DeferredPlayer> _deferred = {};
+
+    OutputBuffer _buffer = {};
+
+    /// One buffer per PlayerA channel tap.
+    std::vector<OutputBuffer> _tap_buffers = {};
+    /// Points to the contents of _tap_buffers, passed to PlayerA::Render().
+    std::vector<void *> _tap_ptrs = {};
+
+    /// Each job emulates the song once, and writes its output to one or more files.
+    std::vector<RenderOutput> _outputs = {};
+
+    /// If set, finished outputs with a cache_key are stored in _cache.
+    std::optional<RenderCache> _cache = {};
+
+    /// If set, the job returns _budget_bytes to _budget when finished.
+    std::shared_ptr<MemoryBudget> _budget = {};
+    int64_t _budget_bytes = 0;
+
+    /// If set, this job only renders the time segment _segment_idx of its outputs.
+    std::shared_ptr<SegmentGroup> _segments = {};
+    size_t _segment_idx = 0;
+
+    /// If set, this job's mixed output is added to master audio as contributor
+    /// _mix_idx of _mix.
+    std::shared_ptr<StemMix> _mix = {};
+    size_t _mix_idx = 0;
+
+    /// Number of frames rendered (excluding segment warm-up).
+    uint64_t _nframes = 0;
 };
 
 class RenderJob : public QRunnable, private RenderJobState {
@@ -383,12 +741,15 @@ public:  // Public for std::make_unique.
     {}
 
 public:
+    /// Creates a job with no outputs. Call add_output() or add_channel_output()
+    /// before starting the job.
+    /// time_multiplier is returned by job_cost().
     static Result<std::unique_ptr<RenderJob>, QString> make(
-        QString name,
-        QString out_path,
-        QByteArray file_data,
+        SongData song_data,
         Metadata const& metadata,
-        RenderSettings const& opt)
+        RenderSettings const& opt,
+        float time_multiplier,
+        std::shared_ptr<TimingLog> timings)
     {
         std::unique_ptr<PlayerBase> engine_move;
 
@@ -404,25 +765,17 @@ public:
 
         UINT8 status;
 
-        auto loader = BoxDataLoader(MemoryLoader_Init(
-            (UINT8 const*) file_data.data(), (UINT32) file_data.size()
-        ));
-        if (loader == nullptr) {
-            return Err(Backend::tr("Failed to allocate MemoryLoader_Init"));
-        }
-
-        DataLoader_SetPreloadBytes(loader.get(), 0x100);
-        status = DataLoader_Load(loader.get());
-        if (status) {
-            return Err(Backend::tr("Failed to extract file, error 0x%1")
-                .arg(format_hex_2(status)));
+        auto maybe_loader = load_song(song_data.bytes);
+        if (maybe_loader.is_err()) {
+            return Err(move(maybe_loader.err_value()));
         }
+        auto loader = move(maybe_loader.value());
 
         auto player = std::make_unique<PlayerA>();
 
         /* setup the player's output parameters and allocate internal buffers */
         if (player->SetOutputSettings(
-            opt.sample_rate, CHANNEL_COUNT, BIT_DEPTH, BUFFER_LEN
+            opt.sample_rate, CHANNEL_COUNT, player_sample_bits(opt.format), BUFFER_LEN
         )) {
             return Err(Backend::tr(
                 "Unsupported channel count/bit depth (this should never happen)"
@@ -442,6 +795,9 @@ public:
 
         PlayerBase * engine = player->GetPlayer();
 
+        // Measure how long each chip takes to emulate, to estimate future render times.
+        engine->SetDeviceProfiling(1);
+
         bool is_song_looped = engine->GetLoopTicks() > 0;
         uint32_t extra_nsamp;
 
@@ -466,14 +822,45 @@ public:
             VGMPlayer* vgmplay = dynamic_cast<VGMPlayer *>(engine);
             release_assert(vgmplay);
             player->SetLoopCount(vgmplay->GetModifiedLoopCount(opt.loop_count));
+
+            // Chips disabled before Start() are never allocated, and other chips'
+            // disabled halves get no register writes. Data blocks and DAC streams are
+            // still processed.
+            if (opt.solo) {
+                VGM_PLAY_OPTIONS play_opts;
+                vgmplay->GetPlayerOptions(play_opts);
+                play_opts.skipDisabledDevs = 1;
+                vgmplay->SetPlayerOptions(play_opts);
+            }
+        }
+
+        // Mute all but one channel. Muting stays fixed for the whole render, so set
+        // it before Start(), which applies it when creating each chip. (Calling
+        // PlayerBase::SetDeviceMuting() with PLR_DEV_ID(chip, instance) works before
+        // calling PlayerA::Start(), but not with channel indices.)
+        if (opt.solo) {
+            for (ChipMetadata const& chip : metadata.chips) {
+                if (chip.chip_id == opt.solo->chip_id && chip.type == DEVID_YM2612) {
+                    // Muted channels already skip operator output, this also skips
+                    // their envelopes.
+                    PLR_DEV_OPTS dev_opts;
+                    status = engine->GetDeviceOptions(chip.chip_id, dev_opts);
+                    assert(status == 0);
+                    dev_opts.coreOpts |= OPT_YM2612_SKIP_MUTED_EG;
+                    status = engine->SetDeviceOptions(chip.chip_id, dev_opts);
+                    assert(status == 0);
+                }
+                status = engine->SetDeviceMuting(
+                    chip.chip_id, solo_mute_opts(chip, *opt.solo)
+                );
+                assert(status == 0);
+            }
         }
 
-        // Calling PlayerBase::SetDeviceMuting() with channel indices fails if you
-        // haven't called PlayerA::Start(). (Calling PlayerBase::SetDeviceMuting() with
-        // PLR_DEV_ID(chip, instance) works before calling PlayerA::Start().)
-        //
         // It's not necessary to call Start() before GetTotalTime() (but it is
         // necessary to call it before Tick2Sample()).
+        //
+        // PlayerA::AddChannelTap() also requires the player to be started.
         player->Start();
 
         /* figure out how many total frames we're going to render */
@@ -481,53 +868,233 @@ public:
             engine->Tick2Sample(engine->GetTotalPlayTicks(player->GetLoopCount()))
             + extra_nsamp;
 
-        float time_multiplier = 1.f;
+        std::optional<LoopBounds> loop;
+        if (opt.copy_loops && is_song_looped && player->GetLoopCount() >= 3) {
+            uint32_t count = player->GetLoopCount();
+            uint32_t begin =
+                engine->Tick2Sample(engine->GetTotalTicks() - engine->GetLoopTicks());
+            uint32_t first_end = engine->Tick2Sample(engine->GetTotalPlayTicks(1));
+            uint32_t length = first_end - begin;
+
+            // Tick2Sample() rounds, so passes may differ in length by a frame. Only copy
+            // passes if they're all the same length.
+            bool same_length =
+                engine->Tick2Sample(engine->GetTotalPlayTicks(2)) == first_end + length
+                && engine->Tick2Sample(engine->GetTotalPlayTicks(count))
+                    == begin + (uint64_t) count * length;
+            if (length > 0 && same_length) {
+                loop = LoopBounds {
+                    .begin = begin,
+                    .length = length,
+                    .count = count,
+                };
+            }
+        }
 
-        // Mute all but one channel.
-        if (opt.solo) {
-            SoloSettings const& solo = *opt.solo;
+        return Ok(std::make_unique<RenderJob>(RenderJobState {
+            ._time_multiplier = time_multiplier,
+            ._solo = opt.solo,
+            ._timings = move(timings),
+            // Progress range is [0..time in seconds].
+            ._duration = (int) (render_nsamp / opt.sample_rate),
+            ._render_nsamp = render_nsamp,
+            ._sample_rate = opt.sample_rate,
+            ._player_memory = player_memory(metadata),
+            ._format = opt.format,
+            ._loop = loop,
+            ._song_data = move(song_data),
+            ._loader = move(loader),
+            ._player = move(player),
+        }));
+    }
 
-            for (ChipMetadata const& chip : metadata.chips) {
-                PLR_MUTE_OPTS mute{};
+    /// Creates a job like make(), but without loading the song or creating a player
+    /// until the job runs. The song's duration and loop are copied from like, which
+    /// must render the same song with the same settings (apart from opt.solo).
+    static std::unique_ptr<RenderJob> make_deferred(
+        RenderJob const& like,
+        std::shared_ptr<Metadata const> metadata,
+        RenderSettings const& opt,
+        float time_multiplier)
+    {
+        return std::make_unique<RenderJob>(RenderJobState {
+            ._time_multiplier = time_multiplier,
+            ._solo = opt.solo,
+            ._timings = like._timings,
+            ._duration = like._duration,
+            ._render_nsamp = like._render_nsamp,
+            ._sample_rate = like._sample_rate,
+            ._player_memory = like._player_memory,
+            ._format = like._format,
+            ._loop = like._loop,
+            ._song_data = like._song_data,
+            ._loader = {},
+            ._player = {},
+            ._deferred = DeferredPlayer {
+                .metadata = move(metadata),
+                .settings = opt,
+            },
+        });
+    }
 
-                if (chip.chip_id != solo.chip_id) {
-                    mute.disable = 0xff;
-                    // Probably unnecessary, but do it anyway.
-                    mute.chnMute[0] = mute.chnMute[1] = ~0u;
+    /// Writes the player's output to a file. Returns the output index.
+    size_t add_output(QString name, QString path, QByteArray cache_key = {}) {
+        return push_output(move(name), move(path), {}, move(cache_key));
+    }
 
-                } else for (size_t subchip_idx = 0; subchip_idx < 2; subchip_idx++) {
-                    if (subchip_idx != solo.subchip_idx) {
-                        mute.disable |= (uint8_t) (1 << subchip_idx);
-                        // Probably unnecessary, but do it anyway.
-                        mute.chnMute[subchip_idx] = ~0u;
+    /// Writes a single channel to a file, in the same pass as the job's other
+    /// outputs. Returns the output index, or nullopt if the channel's sound core
+    /// can't expose per-channel output (in which case the caller should render
+    /// a separate soloed job instead).
+    std::optional<size_t> add_channel_output(
+        QString name, QString path, SoloSettings const& solo, QByteArray cache_key = {}
+    ) {
+        auto tap_idx = add_tap(solo);
+        if (!tap_idx) {
+            return {};
+        }
+        return push_output(
+            move(name), move(path), *tap_idx, move(cache_key), solo);
+    }
 
-                    } else {
-                        mute.chnMute[subchip_idx] = (~0u) ^ (1 << solo.chan_idx);
-                    }
-                }
-                status = engine->SetDeviceMuting(chip.chip_id, mute);
-                assert(status == 0);
+    size_t output_count() const {
+        return _outputs.size();
+    }
+
+    /// Song duration in seconds.
+    int duration() const {
+        return _duration;
+    }
+
+    void set_cache(RenderCache cache) {
+        _cache = move(cache);
+    }
+
+    /// Deletes an output's file once rendered if every sample is zero, rather than
+    /// keeping a file of silence. Used for channels which may be unused
+    /// (ChannelActivity::Unknown).
+    void set_drop_if_silent(size_t output_idx) {
+        _outputs[output_idx].drop_if_silent = true;
+    }
+
+    /// Leaves subchips (a bitmask of subchip_idx) of a chip out of the player's
+    /// mixed output, and stops emulating them. Used to leave chips out of a full
+    /// job's output when they're summed from soloed jobs instead.
+    void disable_chip(ChipId chip_id, uint8_t subchip_mask) {
+        PlayerBase * engine = _player->GetPlayer();
+        PLR_MUTE_OPTS mute;
+        [[maybe_unused]] UINT8 status = engine->GetDeviceMuting(chip_id, mute);
+        assert(status == 0);
+        mute.disable |= subchip_mask;
+        status = engine->SetDeviceMuting(chip_id, mute);
+        assert(status == 0);
+    }
+
+    /// Adds this job's mixed output to master audio, as contributor mix_idx.
+    /// Must be called before start_consume().
+    void set_mix(std::shared_ptr<StemMix> mix, size_t mix_idx) {
+        if (mix_idx == 0) {
+            mix->sum.reserve((size_t) _render_nsamp * CHANNEL_COUNT);
+        }
+        _mix = move(mix);
+        _mix_idx = mix_idx;
+    }
+
+    bool is_mixed() const {
+        return _mix != nullptr;
+    }
+
+    /// Whether the job writes any output or contributes to master audio. Other jobs
+    /// aren't started.
+    bool has_work() const {
+        return !_outputs.empty() || _mix;
+    }
+
+    /// Estimated CPU time (in seconds) to emulate the song (or this job's segment).
+    float cost() const {
+        if (_segments) {
+            uint32_t sample_rate = _sample_rate;
+            uint32_t begin = _segments->bounds[_segment_idx];
+            uint32_t end = _segments->bounds[_segment_idx + 1];
+            uint32_t warmup = std::min(begin, SEGMENT_WARMUP_SECONDS * sample_rate);
+            auto seconds = (float) (end - begin + warmup) / (float) sample_rate;
+            return _time_multiplier * std::max(seconds, 1.f);
+        }
+        return _time_multiplier * (float) std::max(_duration, 1);
+    }
+
+    /// Splits this job into nseg jobs which render consecutive time segments of the
+    /// same outputs in parallel. This job renders the first segment, and the other
+    /// segments are appended to out.
+    ///
+    /// Segments after the first start with a fast register-only seek (which doesn't
+    /// emulate chips), followed by a warm-up. This means the output isn't bit-exact
+    /// near segment boundaries (oscillator phases may differ), so split outputs
+    /// are not stored in the render cache.
+    ///
+    /// Must be called before start_consume().
+    void split(
+        size_t nseg,
+        std::shared_ptr<Metadata const> const& metadata,
+        RenderSettings const& opt,
+        std::vector<std::unique_ptr<RenderJob>> & out)
+    {
+        release_assert(!_segments);
+        release_assert(nseg >= 2);
+
+        std::vector<uint32_t> bounds;
+        for (size_t i = 0; i <= nseg; i++) {
+            bounds.push_back((uint32_t) ((uint64_t) _render_nsamp * i / nseg));
+        }
+        auto group = std::make_shared<SegmentGroup>(move(bounds));
+
+        for (RenderOutput & output : _outputs) {
+            output.cache_key = QByteArray();
+            // Each segment only sees part of the output.
+            output.drop_if_silent = false;
+            // Segments open the file without truncating it, so remove the old file
+            // before any segment starts.
+            QFile::remove(output.path);
+        }
+
+        auto seg_opt = opt;
+        seg_opt.solo = _solo;
+
+        for (size_t i = 1; i < nseg; i++) {
+            // Each segment adds the channel taps of its outputs once it creates its
+            // player.
+            auto job = make_deferred(*this, metadata, seg_opt, _time_multiplier);
+            for (RenderOutput const& output : _outputs) {
+                // Copying a QFutureInterface shares its state, so every segment
+                // reports to the same QFuture.
+                job->_outputs.push_back(output);
             }
-        } else {
-            time_multiplier = metadata.master_audio_time_multiplier;
+            job->_cache = _cache;
+            job->_segments = group;
+            job->_segment_idx = i;
+            out.push_back(move(job));
         }
 
-        auto out = std::make_unique<RenderJob>(RenderJobState {
-            ._name = move(name),
-            ._out_path = move(out_path),
-            ._time_multiplier = time_multiplier,
-            ._file_data = move(file_data),
-            ._loader = move(loader),
-            ._player = move(player),
-        });
-        // Progress range is [0..time in seconds].
-        out->_status.setProgressRange(0, (int) (render_nsamp / opt.sample_rate));
+        _segments = move(group);
+        _segment_idx = 0;
+    }
 
-        // The initial progress value is already 0, but we need to call
-        // setProgressValue(0) so reportResult() doesn't increment the progress value.
-        out->_status.setProgressValue(0);
+    /// Estimated memory used by this job, excluding the song data shared with other
+    /// jobs.
+    int64_t memory_estimate() const {
+        int64_t bytes = _player_memory + OUTPUT_MEMORY * (int64_t) _outputs.size();
+        // Charge master audio's sum to its first contributor.
+        if (_mix && _mix_idx == 0) {
+            bytes += OUTPUT_MEMORY
+                + (int64_t) _render_nsamp * CHANNEL_COUNT * (int64_t) sizeof(int32_t);
+        }
+        return bytes;
+    }
 
-        return Ok(std::move(out));
+    /// Releases bytes from budget once the job finishes (or is canceled).
+    void set_budget(std::shared_ptr<MemoryBudget> budget, int64_t bytes) {
+        _budget = move(budget);
+        _budget_bytes = bytes;
     }
 
     void start_consume(QThreadPool * pool) {
@@ -535,96 +1102,646 @@ public:
         // I'm not sure why you need to call setThreadPool or setRunnable, especially
         // since Qt 6's QPromise (https://invent.kde.org/qt/qt/qtbase/-/blob/dev/src/corelib/thread/qpromise.h)
         // sets neither.
-        _status.setThreadPool(pool);
-        _status.setRunnable(this);
-        _status.reportStarted();
-        pool->start(this);
+        for (RenderOutput & output : _outputs) {
+            output.status.setThreadPool(pool);
+            output.status.setRunnable(this);
+            output.status.reportStarted();
+        }
+        if (_mix && !_mix->output.status.isStarted()) {
+            _mix->pool = pool;
+            _mix->output.status.setThreadPool(pool);
+            _mix->output.status.reportStarted();
+        }
+
+        // QThreadPool starts queued jobs with higher priority first. Start the most
+        // expensive jobs first (longest-processing-time-first scheduling), so a slow
+        // job (like master audio) isn't started last and left running alone at the
+        // end of a render.
+        pool->start(this, (int) std::min(cost() * 1000.f, (float) INT_MAX / 2));
     }
 
-    RenderJobHandle future() {
+    RenderJobHandle future(size_t output_idx) {
+        RenderOutput & output = _outputs[output_idx];
         return RenderJobHandle {
-            .name = _name,
-            .path = _out_path,
-            .time_multiplier = _time_multiplier,
-            .future = _status.future(),
+            .name = output.name,
+            .path = output.path,
+            .time_multiplier = _time_multiplier / (float) _outputs.size(),
+            .future = output.status.future(),
+            .dropped = output.dropped,
         };
     }
 
 private:
-    void callback() {
-        uint32_t sample_rate = _player->GetSampleRate();
-
-        auto maybe_writer = Wave_Writer::make(sample_rate, _out_path);
-        if (maybe_writer.is_err()) {
-            _status.reportResult(
-                Backend::tr("Error opening file: %1").arg(maybe_writer.err_value())
-            );
-            return;
+    /// Records a channel into a new tap buffer. Returns the tap index, or nullopt if
+    /// the channel's sound core can't expose per-channel output.
+    std::optional<size_t> add_tap(SoloSettings const& solo) {
+        size_t tap_idx =
+            _player->AddChannelTap(solo.chip_id, solo.subchip_idx, solo.chan_idx);
+        if (tap_idx == (size_t) -1) {
+            return {};
         }
-        auto writer = std::move(maybe_writer.value());
-        writer->enable_stereo();
+        release_assert(tap_idx == _tap_buffers.size());
 
-        uint32_t curr_samp = 0;
-        int curr_progress = 0;
+        // Moving a BoxArray doesn't move its contents, so the pointers in _tap_ptrs
+        // remain valid when _tap_buffers grows.
+        _tap_buffers.push_back(OutputBuffer{});
+        _tap_ptrs.push_back(_tap_buffers.back().data());
+        return tap_idx;
+    }
 
-        bool done = false;
-        while (!done) {
-            if (_status.isCanceled()) {
-                return;
+    /// Creates the player of a job returned by make_deferred(), and adds a channel tap
+    /// for each output which records one. If non-empty, holds error message.
+    [[nodiscard]] QString create_player() {
+        auto maybe_job = make(
+            _song_data, *_deferred->metadata, _deferred->settings, _time_multiplier,
+            _timings);
+        if (maybe_job.is_err()) {
+            return move(maybe_job.err_value());
+        }
+        RenderJob & job = *maybe_job.value();
+        _loader = move(job._loader);
+        _player = move(job._player);
+        _deferred.reset();
+
+        for (RenderOutput const& output : _outputs) {
+            if (output.tap_channel) {
+                auto tap_idx = add_tap(*output.tap_channel);
+                release_assert(tap_idx && tap_idx == output.tap_idx);
             }
+        }
+        return {};
+    }
 
-            std::fill(_buffer.begin(), _buffer.end(), 0);
+    size_t push_output(
+        QString name,
+        QString path,
+        std::optional<size_t> tap_idx,
+        QByteArray cache_key,
+        std::optional<SoloSettings> tap_channel = {}
+    ) {
+        _outputs.push_back(RenderOutput {
+            .name = move(name),
+            .path = move(path),
+            .tap_idx = tap_idx,
+            .tap_channel = tap_channel,
+            .cache_key = move(cache_key),
+        });
+        auto & status = _outputs.back().status;
+        status.setProgressRange(0, _duration);
 
-            // Render audio.
-            //
-            // PlayerA::Render() takes buffer size in bytes, and returns bytes written.
-            // We convert it into frames written.
-            //
-            // On song end, PlayerA::Render() performs a short write and sets
-            // PlayerA::GetState() |= PLAYSTATE_FIN.
-            uint32_t curr_frames =
-                _player->Render(
-                    BUFFER_LEN * CHANNEL_COUNT * (BIT_DEPTH / 8), _buffer.data()
-                ) / CHANNEL_COUNT / (BIT_DEPTH / 8);
-            if (_player->GetState() & PLAYSTATE_FIN) {
-                done = true;
-            }
+        // The initial progress value is already 0, but we need to call
+        // setProgressValue(0) so reportResult() doesn't increment the progress value.
+        status.setProgressValue(0);
 
-            // Write audio. Pass buffer size in samples.
+        return _outputs.size() - 1;
+    }
+
+    /// Size of one frame of audio in bytes.
+    uint32_t frame_size() const {
+        return CHANNEL_COUNT * sample_size(_format);
+    }
+
+    uint8_t const* output_buffer(RenderOutput const& output) const {
+        if (output.tap_idx) {
+            return _tap_buffers[*output.tap_idx].data();
+        }
+        return _buffer.data();
+    }
+
+    /// Reports how long each chip took to emulate.
+    void save_timings() {
+        std::vector<PLR_DEV_PROFILE> profiles;
+        if (_player->GetPlayer()->GetDeviceProfiles(profiles)) {
+            return;
+        }
+        uint32_t sample_rate = _player->GetSampleRate();
+
+        auto lock = std::lock_guard(_timings->mutex);
+        for (PLR_DEV_PROFILE const& profile : profiles) {
+            if (profile.smplCount == 0 || profile.emuTime == 0) {
+                continue;
+            }
+            _timings->timings.push_back(CoreTiming {
+                .type = profile.type,
+                .core = profile.core,
+                .solo = _solo.has_value(),
+                .chip_samples = (double) profile.smplCount
+                    * (double) profile.smplRate / (double) sample_rate,
+                .seconds = (double) profile.emuTime / 1e9,
+            });
+        }
+    }
+
+    /// Renders and discards audio until reaching frame begin, starting from a
+    /// register-only seek shortly before it.
+    void skip_to(uint32_t begin) {
+        uint32_t warmup =
+            std::min(begin, SEGMENT_WARMUP_SECONDS * _player->GetSampleRate());
+        _player->Seek(PLAYPOS_SAMPLE, begin - warmup);
+
+        while (warmup > 0) {
+            uint32_t nframes = std::min(warmup, BUFFER_LEN);
+            uint32_t curr_frames =
+                _player->Render(
+                    nframes * frame_size(), _buffer.data(), _tap_ptrs.data()
+                ) / frame_size();
+            if (curr_frames == 0 || _player->GetState() & PLAYSTATE_FIN) {
+                break;
+            }
+            warmup -= curr_frames;
+        }
+    }
+
+    /// Sets the progress of every output with an open writer. If this job renders a
+    /// segment, reports the total progress of all segments.
+    void report_progress(
+        int progress, std::vector<std::unique_ptr<Wave_Writer>> const& writers
+    ) {
+        if (_mix) {
+            // Master audio is finished once the slowest contributing job finishes.
+            int mix_progress;
+            {
+                auto lock = std::lock_guard(_mix->mutex);
+                _mix->progress[_mix_idx] = progress;
+                mix_progress =
+                    *std::min_element(_mix->progress.begin(), _mix->progress.end());
+            }
+            _mix->output.status.setProgressValue(mix_progress);
+        }
+        if (_segments) {
+            auto lock = std::lock_guard(_segments->mutex);
+            _segments->progress[_segment_idx] = progress;
+            progress = 0;
+            for (int p : _segments->progress) {
+                progress += p;
+            }
+        }
+        for (auto const& [i, output] : enumerate<size_t>(_outputs)) {
+            if (writers[i]) {
+                output.status.setProgressValue(progress);
+            }
+        }
+    }
+
+    /// Adds nframes of the player's mixed output, starting at frame begin, to master
+    /// audio. Only used for 16-bit output.
+    void add_to_mix(uint32_t begin, uint32_t nframes) {
+        assert(_format == SampleFormat::Int16);
+        size_t const nsamp = (size_t) nframes * CHANNEL_COUNT;
+        auto const* buffer = reinterpret_cast<int16_t const*>(_buffer.data());
+
+        // Master audio only clips the sum of every channel, so if this job's output
+        // clipped, the sum doesn't match master audio.
+        bool clipped = std::any_of(
+            buffer, buffer + nsamp,
+            [](int16_t a) { return a == INT16_MAX || a == INT16_MIN; });
+
+        auto lock = std::lock_guard(_mix->mutex);
+        size_t const offset = (size_t) begin * CHANNEL_COUNT;
+        if (_mix->sum.size() < offset + nsamp) {
+            _mix->sum.resize(offset + nsamp);
+        }
+        for (size_t i = 0; i < nsamp; i++) {
+            _mix->sum[offset + i] += buffer[i];
+        }
+        _mix->clipped |= clipped;
+    }
+
+    /// Appends copies of the second pass through the loop to every open file, until
+    /// it has been played loop.count times.
+    void copy_passes(
+        LoopBounds const& loop,
+        std::vector<std::unique_ptr<Wave_Writer>> & writers,
+        size_t & nactive
+    ) {
+        uint64_t second_pass = loop.begin + loop.length;
+        for (auto const& [i, output] : enumerate<size_t>(_outputs)) {
+            for (uint32_t pass = 2; writers[i] && pass < loop.count; pass++) {
+                if (
+                    auto err = writers[i]->copy_samples(
+                        second_pass * CHANNEL_COUNT,
+                        (uint64_t) loop.length * CHANNEL_COUNT
+                    );
+                    !err.isEmpty()
+                ) {
+                    output.status.reportResult(
+                        Backend::tr("Error writing data: %1").arg(err)
+                    );
+                    writers[i].reset();
+                    nactive--;
+                }
+            }
+        }
+    }
+
+    void callback() {
+        uint32_t sample_rate = _player->GetSampleRate();
+        uint64_t expected_nsamp = (uint64_t) _render_nsamp * CHANNEL_COUNT;
+
+        // If set, stop rendering after this many frames. The last segment renders
+        // until the song ends, in case the song is longer than estimated.
+        std::optional<uint32_t> max_frames;
+        uint32_t begin = 0;
+        if (_segments) {
+            begin = _segments->bounds[_segment_idx];
+            if (_segment_idx + 1 < _segments->size()) {
+                max_frames = _segments->bounds[_segment_idx + 1] - begin;
+            }
+        }
+
+        // Outputs which failed or were canceled have a null writer.
+        std::vector<std::unique_ptr<Wave_Writer>> writers(_outputs.size());
+        size_t nactive = 0;
+
+        // Whether each output with drop_if_silent has written a nonzero sample.
+        std::vector<bool> audible(_outputs.size());
+
+        for (auto const& [i, output] : enumerate<size_t>(_outputs)) {
+            if (output.status.isCanceled()) {
+                continue;
+            }
+            // Another segment failed to write this file.
+            if (_segments && output.status.resultCount() > 0) {
+                continue;
+            }
+
+            if (_segments) {
+                // split() already removed the old file.
+                auto maybe_writer = Wave_Writer::make_segment(
+                    sample_rate,
+                    _format,
+                    output.path,
+                    expected_nsamp,
+                    (uint64_t) begin * CHANNEL_COUNT
+                );
+                if (maybe_writer.is_err()) {
+                    output.status.reportResult(Backend::tr("Error opening file: %1")
+                        .arg(maybe_writer.err_value()));
+                    continue;
+                }
+                writers[i] = std::move(maybe_writer.value());
+                writers[i]->enable_stereo();
+                writers[i]->enable_async();
+                nactive++;
+                continue;
+            }
+
+            // Replace existing files rather than overwriting them in place, since they
+            // may be hard-linked to render cache entries.
+            QFile::remove(output.path);
+
+            auto maybe_writer =
+                Wave_Writer::make(sample_rate, _format, output.path, expected_nsamp);
+            if (maybe_writer.is_err()) {
+                output.status.reportResult(
+                    Backend::tr("Error opening file: %1").arg(maybe_writer.err_value())
+                );
+                continue;
+            }
+            writers[i] = std::move(maybe_writer.value());
+            writers[i]->enable_stereo();
+            writers[i]->enable_async();
             if (
-                auto err = writer->write(_buffer.data(), curr_frames * CHANNEL_COUNT);
+                auto err = writers[i]->preallocate(expected_nsamp);
                 !err.isEmpty()
             ) {
-                _status.reportResult(Backend::tr("Error writing data: %1").arg(err));
+                output.status.reportResult(
+                    Backend::tr("Error allocating file: %1").arg(err)
+                );
+                writers[i].reset();
+                continue;
+            }
+            nactive++;
+        }
+
+        if (begin > 0) {
+            skip_to(begin);
+        }
+
+        // If the first two passes through the loop render the same audio, later passes
+        // are copied from the second pass. Segments and jobs adding to master audio
+        // need every frame rendered, so they don't copy passes.
+        //
+        // libvgm can't compare chip state, so identical audio stands in for it. Only
+        // jobs which run every chip unmuted copy passes, and they compare the full mix
+        // as well as their outputs. Soloed jobs only hear one channel, so muted
+        // channels (and LFOs, noise generators, or envelopes) could differ unnoticed.
+        std::optional<LoopBounds> loop;
+        if (!_segments && !_mix && !_solo) {
+            loop = _loop;
+        }
+        // Hashes of the full mix and every output during the first and second pass
+        // through the loop.
+        uint64_t pass_hashes[2] = {HASH_INIT, HASH_INIT};
+        // Copied passes aren't checked for identical chip state, so don't cache them.
+        bool copied_loop = false;
+
+        uint32_t curr_samp = 0;
+        int curr_progress = 0;
+
+        bool done = false;
+        while (!done) {
+            for (auto const& [i, output] : enumerate<size_t>(_outputs)) {
+                if (writers[i] && output.status.isCanceled()) {
+                    writers[i].reset();
+                    nactive--;
+                }
+            }
+            // Keep rendering until the song ends if master audio needs this job's
+            // output, even if all of this job's own files were canceled.
+            if (nactive == 0 && !(_mix && !_mix->output.status.isCanceled())) {
                 return;
             }
+
+            std::fill(_buffer.begin(), _buffer.end(), 0);
+            for (OutputBuffer & buffer : _tap_buffers) {
+                std::fill(buffer.begin(), buffer.end(), 0);
+            }
+
+            // Render audio.
+            //
+            // PlayerA::Render() takes buffer size in bytes, and returns bytes written.
+            // We convert it into frames written.
+            //
+            // On song end, PlayerA::Render() performs a short write and sets
+            // PlayerA::GetState() |= PLAYSTATE_FIN.
+            uint32_t nframes = BUFFER_LEN;
+            if (max_frames) {
+                nframes = std::min(nframes, *max_frames - curr_samp);
+            }
+            if (loop) {
+                // Stop at the start and end of each pass, so each buffer only holds
+                // audio from one pass.
+                for (uint32_t pass = 0; pass <= 2; pass++) {
+                    uint32_t bound = loop->begin + pass * loop->length;
+                    if (curr_samp < bound) {
+                        nframes = std::min(nframes, bound - curr_samp);
+                        break;
+                    }
+                }
+            }
+            uint32_t curr_frames =
+                _player->Render(
+                    nframes * frame_size(), _buffer.data(), _tap_ptrs.data()
+                ) / frame_size();
+            if (_player->GetState() & PLAYSTATE_FIN) {
+                done = true;
+            }
+            if (max_frames && curr_samp + curr_frames >= *max_frames) {
+                done = true;
+            }
+
+            // Write audio. Pass buffer size in samples.
+            for (auto const& [i, output] : enumerate<size_t>(_outputs)) {
+                if (!writers[i]) {
+                    continue;
+                }
+                if (
+                    auto err = writers[i]->write(
+                        output_buffer(output), curr_frames * CHANNEL_COUNT
+                    );
+                    !err.isEmpty()
+                ) {
+                    output.status.reportResult(
+                        Backend::tr("Error writing data: %1").arg(err)
+                    );
+                    writers[i].reset();
+                    nactive--;
+                    continue;
+                }
+                if (output.drop_if_silent && !audible[i]) {
+                    // Silence is zero bytes in every format.
+                    uint8_t const* buffer = output_buffer(output);
+                    audible[i] = std::any_of(
+                        buffer, buffer + curr_frames * frame_size(),
+                        [](uint8_t a) { return a != 0; });
+                }
+            }
+            if (_mix) {
+                add_to_mix(curr_samp, curr_frames);
+            }
+            if (loop && curr_samp >= loop->begin) {
+                uint64_t & hash = pass_hashes[(curr_samp - loop->begin) / loop->length];
+                hash = hash_bytes(hash, _buffer.data(), curr_frames * frame_size());
+                for (RenderOutput const& output : _outputs) {
+                    hash = hash_bytes(
+                        hash, output_buffer(output), curr_frames * frame_size());
+                }
+            }
             curr_samp += curr_frames;
 
+            if (loop && curr_samp == loop->begin + 2 * loop->length) {
+                if (pass_hashes[0] == pass_hashes[1]) {
+                    copy_passes(*loop, writers, nactive);
+                    // The player is at the end of the second pass, with the same audio
+                    // as the end of the last pass (and probably the same chip state,
+                    // though state which doesn't affect the mix isn't compared). Fade
+                    // out from here.
+                    _player->SetLoopCount(2);
+                    // The loop event only starts the fade once the loop count is
+                    // reached. Tick2Sample() rounding lets the second pass's loop event
+                    // fire within the step which just ended, before the count was
+                    // lowered, so start the fade directly.
+                    if (_player->GetCurLoop() >= 2) {
+                        _player->FadeOut();
+                    }
+                    curr_samp += (loop->count - 2) * loop->length;
+                    copied_loop = true;
+                }
+                loop.reset();
+            }
+
             // Set current time in seconds.
             auto progress = (int) (curr_samp / sample_rate);
             if (progress != curr_progress) {
                 // Only call setProgressValue() when progress has changed, to avoid
                 // unnecessary mutex locking.
-                _status.setProgressValue(progress);
+                report_progress(progress, writers);
                 curr_progress = progress;
             }
         }
+        _nframes = curr_samp;
 
-        if (auto err = writer->close(); !err.isEmpty()) {
-            _status.reportResult(Backend::tr("Error finalizing file: %1").arg(err));
+        for (auto const& [i, output] : enumerate<size_t>(_outputs)) {
+            if (!writers[i]) {
+                continue;
+            }
+            if (auto err = writers[i]->close(); !err.isEmpty()) {
+                output.status.reportResult(
+                    Backend::tr("Error finalizing file: %1").arg(err)
+                );
+                continue;
+            }
+            bool const silent = output.drop_if_silent && !audible[i];
+            if (silent) {
+                QFile::remove(output.path);
+                *output.dropped = true;
+            }
+            if (_cache && !output.cache_key.isEmpty() && !copied_loop) {
+                // Remember silent channels too, so they aren't emulated again only to
+                // be deleted.
+                if (silent) {
+                    _cache->store_silent(output.cache_key);
+                } else {
+                    _cache->store(output.cache_key, output.path);
+                }
+            }
+        }
+    }
+
+    /// Called once this job's segment finishes (or is canceled). Returns whether every
+    /// segment has finished, in which case this writes the file headers.
+    bool finish_segment() {
+        uint64_t nframes;
+        {
+            auto lock = std::lock_guard(_segments->mutex);
+            _segments->nframes[_segment_idx] = _nframes;
+            if (--_segments->nremaining > 0) {
+                return false;
+            }
+            size_t last = _segments->size() - 1;
+            nframes = _segments->bounds[last] + _segments->nframes[last];
+        }
+
+        uint32_t sample_rate = _sample_rate;
+        for (RenderOutput & output : _outputs) {
+            // Skip outputs which were canceled or failed to write.
+            if (output.status.isCanceled() || output.status.resultCount() > 0) {
+                continue;
+            }
+            if (
+                auto err = Wave_Writer::finish_segments(
+                    sample_rate,
+                    _format,
+                    output.path,
+                    (uint64_t) _render_nsamp * CHANNEL_COUNT,
+                    nframes * CHANNEL_COUNT
+                );
+                !err.isEmpty()
+            ) {
+                output.status.reportResult(
+                    Backend::tr("Error finalizing file: %1").arg(err)
+                );
+            }
+        }
+        return true;
+    }
+
+    /// Called once this job finishes contributing to master audio (or is canceled).
+    /// The last contributing job to finish writes master audio from the sum, or if the
+    /// sum doesn't match master audio, starts a job to render master audio as usual.
+    void finish_mix() {
+        bool usable;
+        {
+            auto lock = std::lock_guard(_mix->mutex);
+            _mix->nframes[_mix_idx] = _nframes;
+            if (--_mix->nremaining > 0) {
+                return;
+            }
+            // Every contributing job renders the same song, so they render the same
+            // number of frames unless one failed or stopped early.
+            uint64_t nframes = _mix->nframes[0];
+            usable = !_mix->clipped
+                && nframes > 0
+                && _mix->sum.size() == nframes * CHANNEL_COUNT
+                && std::all_of(
+                    _mix->nframes.begin(), _mix->nframes.end(),
+                    [&](uint64_t n) { return n == nframes; });
+        }
+
+        RenderOutput & output = _mix->output;
+        if (output.status.isCanceled()) {
+            output.status.reportFinished();
+            return;
+        }
+
+        if (!usable) {
+            _mix->sum = {};
+            auto maybe_job = _mix->make_fallback();
+            if (maybe_job.is_err()) {
+                output.status.reportResult(maybe_job.err_value());
+                output.status.reportFinished();
+                return;
+            }
+            auto job = move(maybe_job.value());
+            // Copying a QFutureInterface shares its state, so the job reports to
+            // master audio's QFuture.
+            job->_outputs.push_back(output);
+            job->_cache = _cache;
+            job.release()->start_consume(_mix->pool);
+            return;
+        }
+
+        std::vector<int32_t> const sum = move(_mix->sum);
+        QFile::remove(output.path);
+        auto maybe_writer = Wave_Writer::make(
+            _sample_rate, SampleFormat::Int16, output.path, sum.size()
+        );
+        if (maybe_writer.is_err()) {
+            output.status.reportResult(
+                Backend::tr("Error opening file: %1").arg(maybe_writer.err_value())
+            );
+            output.status.reportFinished();
             return;
         }
+        auto writer = move(maybe_writer.value());
+        writer->enable_stereo();
+        writer->enable_async();
+
+        auto * buffer = reinterpret_cast<int16_t *>(_buffer.data());
+        size_t const buffer_len = _buffer.size() / sizeof(int16_t);
+        for (size_t i = 0; i < sum.size(); i += buffer_len) {
+            auto nsamp = (uint32_t) std::min(buffer_len, sum.size() - i);
+            std::transform(
+                sum.begin() + (ptrdiff_t) i, sum.begin() + (ptrdiff_t) (i + nsamp),
+                buffer,
+                [](int32_t a) {
+                    return (int16_t)
+                        std::clamp(a, (int32_t) INT16_MIN, (int32_t) INT16_MAX);
+                });
+            if (auto err = writer->write(buffer, nsamp); !err.isEmpty()) {
+                output.status.reportResult(
+                    Backend::tr("Error writing data: %1").arg(err)
+                );
+                output.status.reportFinished();
+                return;
+            }
+        }
+        if (auto err = writer->close(); !err.isEmpty()) {
+            output.status.reportResult(Backend::tr("Error finalizing file: %1").arg(err));
+        }
+        output.status.reportFinished();
     }
 
 // impl QRunnable
 public:
     void run() override {
+        defer {
+            if (_budget) {
+                _budget->release(_budget_bytes);
+            }
+        };
+
         // Based off https://invent.kde.org/qt/qt/qtbase/-/blob/kde/5.15/src/concurrent/qtconcurrentrunbase.h#L95-121
-        if (_status.isCanceled()) {
+        bool all_canceled = std::all_of(
+            _outputs.begin(), _outputs.end(),
+            [](RenderOutput const& output) { return output.status.isCanceled(); });
+        if (_mix && !_mix->output.status.isCanceled()) {
+            all_canceled = false;
+        }
+        if (all_canceled) {
             // Ideally I'd report "Cancelled by user", but after QFuture::cancel() is
             // called (and QFutureInterface::isCanceled() is set),
             // QFutureInterface::reportResult() drops all values.
-            _status.reportFinished();
+            if (_segments && !finish_segment()) {
+                return;
+            }
+            for (RenderOutput & output : _outputs) {
+                output.status.reportFinished();
+            }
+            if (_mix) {
+                finish_mix();
+            }
             return;
         }
 
@@ -638,65 +1755,681 @@ public:
         QThread::currentThread()->setPriority(QThread::LowestPriority);
 
         try {
-            callback();
+            QString err;
+            if (_deferred) {
+                err = create_player();
+            }
+            if (!err.isEmpty()) {
+                for (RenderOutput & output : _outputs) {
+                    output.status.reportResult(err);
+                }
+            } else {
+                callback();
+                // Save timings before reporting that the job has finished, so
+                // they're available once Backend sees all jobs finish.
+                save_timings();
+            }
         } catch (QException & e) {
-            _status.reportException(e);
+            for (RenderOutput & output : _outputs) {
+                output.status.reportException(e);
+            }
         } catch (...) {
-            _status.reportException(QUnhandledException());
+            for (RenderOutput & output : _outputs) {
+                output.status.reportException(QUnhandledException());
+            }
+        }
+        // Every segment shares the same outputs, so only the last segment to finish
+        // reports them as finished.
+        if (_segments && !finish_segment()) {
+            return;
+        }
+        for (RenderOutput & output : _outputs) {
+            output.status.reportFinished();
+        }
+        if (_mix) {
+            finish_mix();
         }
-        _status.reportFinished();
     }
 };
 
+/// Reads and decompresses a file. Decompressing the file once, rather than in every
+/// render job, saves time and memory.
+///
+/// If map is true, uncompressed files are memory-mapped instead of read, so they're
+/// used straight from the page cache. Only map files for the length of one render:
+/// if another program truncates a mapped file, reading it crashes (and on Windows,
+/// the mapping stops other programs from overwriting the file).
+static Result<SongData, QString> read_song(QString const& path, bool map) {
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QFile::ReadOnly)) {
+        return Err(Backend::tr("Failed to open file: %1").arg(file->errorString()));
+    }
+
+    qint64 size = file->size();
+    if (map && size > 0 && size <= INT_MAX) {
+        if (uchar const* map = file->map(0, size)) {
+            auto file_data = QByteArray::fromRawData((char const*) map, (int) size);
+
+            // gzip magic number (.vgz)
+            if (size >= 2 && map[0] == 0x1f && map[1] == 0x8b) {
+                // Decompress straight from the mapping, which is unmapped once file
+                // goes out of scope.
+                auto maybe_song = decompress_song(file_data);
+                if (maybe_song.is_err()) {
+                    return Err(move(maybe_song.err_value()));
+                }
+                return Ok(SongData{move(maybe_song.value()), {}});
+            }
+
+            // The mapping stays valid while any SongData copy holds file.
+            return Ok(SongData{move(file_data), move(file)});
+        }
+    }
+
+    // Fall back to reading files which can't be mapped.
+    QByteArray file_data = file->readAll();
+    if (file_data.size() != size) {
+        return Err(Backend::tr(
+            "Failed to read file data, expected %1 bytes, read %2 bytes, error %3")
+            .arg(size)
+            .arg(file_data.size())
+            .arg(file->errorString()));
+    }
+    file->close();
+
+    auto maybe_song = decompress_song(file_data);
+    if (maybe_song.is_err()) {
+        return Err(move(maybe_song.err_value()));
+    }
+    return Ok(SongData{move(maybe_song.value()), {}});
+}
+
+/// Increment when changes to emulation or .wav output would change rendered files, to
+/// avoid reusing outdated files from the render cache.
+static constexpr uint32_t RENDER_CACHE_VERSION = 2;
+
+/// Identifies a rendered channel's contents. song_hash is a hash of the song data.
+/// If channel is nullopt, identifies master audio.
+static QByteArray render_cache_key(
+    QByteArray const& song_hash,
+    Metadata const& metadata,
+    RenderSettings const& opt,
+    std::optional<SoloSettings> const& channel)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    auto const add = [&hash](auto const& value) {
+        hash.addData(QByteArray::fromRawData((char const*) &value, sizeof value));
+    };
+
+    add(RENDER_CACHE_VERSION);
+    hash.addData(song_hash);
+
+    // Output format and render settings.
+    add(player_sample_bits(opt.format));
+    add(CHANNEL_COUNT);
+    add(opt.sample_rate);
+    add(opt.volume);
+    add(opt.loop_count);
+    add(opt.fade_duration);
+    add(opt.unlooped_tail);
+
+    // Emulation cores.
+    add(metadata.player_type);
+    for (ChipMetadata const& chip : metadata.chips) {
+        add(chip.chip_id);
+        add(chip.type);
+        add(chip.core);
+    }
+
+    // Which channel is written.
+    add(channel.has_value());
+    if (channel) {
+        add(channel->chip_id);
+        add(channel->subchip_idx);
+        add(channel->chan_idx);
+    }
+
+    return hash.result();
+}
+
+/// Returns a handle for an output which was copied from the render cache, or dropped
+/// because the cache recorded it as silent.
+static RenderJobHandle cached_handle(
+    QString name, QString path, int duration, bool dropped = false
+) {
+    QFutureInterface<QString> status;
+    status.reportStarted();
+    status.setProgressRange(0, duration);
+    status.setProgressValue(duration);
+    status.reportFinished();
+
+    return RenderJobHandle {
+        .name = move(name),
+        .path = move(path),
+        .time_multiplier = 0,
+        .future = status.future(),
+        .dropped = std::make_shared<std::atomic<bool>>(dropped),
+    };
+}
+
+/// Splits jobs which take much longer than the average job per CPU core into time
+/// segments rendered in parallel (RenderOptions::split_long_jobs).
+static void split_long_jobs(
+    std::shared_ptr<Metadata const> const& metadata,
+    RenderSettings const& settings,
+    std::vector<std::unique_ptr<RenderJob>> & queued_jobs)
+{
+    auto const ncore = (size_t) std::max(QThread::idealThreadCount(), 1);
+    if (ncore < 2) {
+        return;
+    }
+
+    float total_cost = 0;
+    for (auto const& job : queued_jobs) {
+        if (job->has_work()) {
+            total_cost += job->cost();
+        }
+    }
+    float const target_cost = total_cost / (float) ncore;
+
+    std::vector<std::unique_ptr<RenderJob>> segments;
+    for (auto const& job : queued_jobs) {
+        // Segments can't add to master audio summed from channels, since they each
+        // render a different part of the song.
+        if (
+            job->output_count() == 0
+            || job->is_mixed()
+            || job->cost() <= 1.5f * target_cost
+        ) {
+            continue;
+        }
+        auto nseg = std::min({
+            (size_t) std::ceil(job->cost() / target_cost),
+            ncore,
+            (size_t) (job->duration() / (int) MIN_SEGMENT_SECONDS),
+        });
+        if (nseg < 2) {
+            continue;
+        }
+        job->split(nseg, metadata, settings, segments);
+    }
+
+    for (auto & job : segments) {
+        queued_jobs.push_back(move(job));
+    }
+}
+
+/// Creates (but doesn't start) the render jobs for a song, writing master audio to
+/// path and each channel next to it. Appends a handle for each enabled channel to
+/// handles, in channel order. Returns errors creating jobs.
+static std::vector<QString> make_render_jobs(
+    Settings const& app_settings,
+    SongData const& song_data,
+    Metadata const& metadata,
+    QString const& path,
+    RenderOptions const& options,
+    std::shared_ptr<TimingLog> const& timings,
+    std::optional<RenderCache> const& cache,
+    std::vector<std::unique_ptr<RenderJob>> & queued_jobs,
+    std::vector<RenderJobHandle> & handles)
+{
+    std::vector<QString> errors;
+
+    // The job and output index for each enabled channel, in channel order. If the job
+    // is null, the output was copied from the render cache (or is master audio summed
+    // from other jobs), and the index points into cached_handles.
+    std::vector<std::pair<RenderJob *, size_t>> outputs;
+    std::vector<RenderJobHandle> cached_handles;
+
+    auto const& channels = metadata.flat_channels;
+
+    auto const settings = RenderSettings {
+        .solo = {},
+        .sample_rate = options.sample_rate.value_or(metadata.sample_rate),
+        .format = options.format,
+        .loop_count = options.loop_count,
+        .fade_duration = options.fade_duration,
+        .copy_loops = options.copy_loops,
+    };
+
+    QByteArray song_hash;
+    if (cache) {
+        song_hash =
+            QCryptographicHash::hash(song_data.bytes, QCryptographicHash::Sha256);
+    }
+
+    /// Shared by jobs which create their players once they run.
+    auto const shared_metadata = std::make_shared<Metadata const>(metadata);
+
+    /// Queues a job, or records its error.
+    auto const add_job = [&](
+        QString const& channel_name,
+        Result<std::unique_ptr<RenderJob>, QString> job
+    ) -> RenderJob * {
+        if (job.is_err()) {
+            errors.push_back(Backend::tr("Error rendering %1: %2")
+                .arg(channel_name, job.err_value()));
+            return nullptr;
+        }
+        if (cache) {
+            job.value()->set_cache(*cache);
+        }
+        queued_jobs.push_back(move(job.value()));
+        return queued_jobs.back().get();
+    };
+
+    auto const make_job = [&](
+        QString const& channel_name, std::optional<SoloSettings> const& solo
+    ) -> RenderJob * {
+        auto job_settings = settings;
+        job_settings.solo = solo;
+        return add_job(channel_name, RenderJob::make(
+            song_data,
+            metadata,
+            job_settings,
+            (float) job_cost(app_settings, metadata, solo),
+            timings));
+    };
+
+    /// A channel which can't be recorded from the full job, and needs its own job.
+    struct SoloOutput {
+        /// Index into outputs, filled in once the job is created.
+        size_t output_idx;
+        QString channel_name;
+        QString channel_path;
+        SoloSettings solo;
+        QByteArray cache_key;
+        bool drop_if_silent;
+    };
+    std::vector<SoloOutput> solo_outputs;
+
+    /// If the channel was rendered before with the same settings, copies the file
+    /// from the render cache (or drops it if it was silent) and returns true.
+    /// Otherwise stores the channel's cache key in cache_key, to be filled once
+    /// rendered.
+    auto const try_cached = [&](
+        QString const& channel_name,
+        QString const& channel_path,
+        std::optional<SoloSettings> const& channel,
+        RenderJob const& job,
+        QByteArray & cache_key
+    ) -> bool {
+        if (!cache) {
+            return false;
+        }
+        cache_key = render_cache_key(song_hash, metadata, settings, channel);
+        bool dropped = false;
+        if (cache->is_silent(cache_key)) {
+            // Don't leave a file from an earlier render next to the new outputs.
+            if (QFileInfo::exists(channel_path) && !QFile::remove(channel_path)) {
+                return false;
+            }
+            dropped = true;
+        } else if (!cache->fetch(cache_key, channel_path)) {
+            return false;
+        }
+        outputs.push_back({nullptr, cached_handles.size()});
+        cached_handles.push_back(
+            cached_handle(channel_name, channel_path, job.duration(), dropped));
+        return true;
+    };
+
+    // Emulating the whole song once and capturing each channel's output (on sound
+    // cores which support it) is much faster than emulating the song once per
+    // channel. This is worthwhile if we render master audio anyway, or if we render
+    // at least 2 channels.
+    RenderJob * full_job = nullptr;
+    {
+        size_t nsolo = 0;
+        bool master = false;
+        for (FlatChannelMetadata const& channel : channels) {
+            if (!channel.enabled) {
+                continue;
+            }
+            if (channel.maybe_chip_id != NO_CHIP) {
+                nsolo++;
+            } else {
+                master = true;
+            }
+        }
+
+        if (master || nsolo >= 2) {
+            full_job = make_job(channels[0].numbered_name(0), {});
+            if (!full_job) {
+                return errors;
+            }
+        }
+    }
+
+    // With RenderOptions::master_from_stems, master audio is summed from the full
+    // job's output and every soloed job's output, and chips rendered by soloed jobs
+    // are left out of the full job. The sum only matches master audio if every
+    // channel is rendered (or never plays), and every chip mixes its channels
+    // linearly.
+    bool const sum_stems = options.master_from_stems
+        && settings.format == SampleFormat::Int16
+        && full_job
+        && std::all_of(channels.begin(), channels.end(),
+            [](FlatChannelMetadata const& channel) {
+                return channel.enabled || channel.activity == ChannelActivity::Silent;
+            })
+        && std::all_of(metadata.chips.begin(), metadata.chips.end(), mixes_linearly);
+
+    /// If master audio may be summed, the index into outputs where it belongs.
+    std::optional<size_t> mixed_master_idx;
+    QString mixed_master_name;
+    QByteArray mixed_master_key;
+
+    /// Subchips (bitmasks of subchip_idx) which must stay in the full job's output,
+    /// since their channels are recorded from it or were copied from the cache.
+    std::map<ChipId, uint8_t> full_subchips;
+
+    for (auto const& [chan_idx, channel] : enumerate<size_t>(channels)) {
+        if (!channel.enabled) {
+            continue;
+        }
+
+        auto const channel_name = channel.numbered_name(chan_idx);
+
+        // Write master audio to the chosen path.
+        if (channel.maybe_chip_id == NO_CHIP) {
+            release_assert(full_job);
+            QByteArray cache_key;
+            if (try_cached(channel_name, path, {}, *full_job, cache_key)) {
+                continue;
+            }
+            if (sum_stems) {
+                // Filled in once all other jobs are created.
+                mixed_master_idx = outputs.size();
+                mixed_master_name = channel_name;
+                mixed_master_key = move(cache_key);
+                outputs.push_back({nullptr, 0});
+                continue;
+            }
+            outputs.push_back({
+                full_job, full_job->add_output(channel_name, path, move(cache_key))
+            });
+            continue;
+        }
+
+        // For per-channel outputs, record the channel from the full job if possible,
+        // otherwise create a job which solos the channel.
+        auto solo = SoloSettings {
+            .chip_id = channel.maybe_chip_id,
+            .subchip_idx = channel.subchip_idx,
+            .chan_idx = channel.chan_idx,
+        };
+        auto info = QFileInfo(path);
+        auto channel_path = info.dir()
+            .absoluteFilePath(QStringLiteral("%1 - %2.wav").arg(
+                info.completeBaseName(), channel_name
+            ));
+
+        // The load-time scan couldn't tell if the channel is used, so check while
+        // rendering instead.
+        bool const drop_if_silent = channel.activity == ChannelActivity::Unknown;
+
+        QByteArray cache_key;
+        if (full_job) {
+            if (try_cached(channel_name, channel_path, solo, *full_job, cache_key)) {
+                full_subchips[solo.chip_id] |= (uint8_t) (1 << solo.subchip_idx);
+                continue;
+            }
+            if (auto output_idx = full_job->add_channel_output(
+                channel_name, channel_path, solo, cache_key
+            )) {
+                full_subchips[solo.chip_id] |= (uint8_t) (1 << solo.subchip_idx);
+                if (drop_if_silent) {
+                    full_job->set_drop_if_silent(*output_idx);
+                }
+                outputs.push_back({full_job, *output_idx});
+                continue;
+            }
+
+            // The soloed job is created below, after every channel is assigned.
+            solo_outputs.push_back(SoloOutput {
+                .output_idx = outputs.size(),
+                .channel_name = channel_name,
+                .channel_path = move(channel_path),
+                .solo = solo,
+                .cache_key = move(cache_key),
+                .drop_if_silent = drop_if_silent,
+            });
+            outputs.push_back({nullptr, 0});
+            continue;
+        }
+
+        if (RenderJob * job = make_job(channel_name, solo)) {
+            // If there's no full job, we need a soloed job to find the song duration,
+            // even if the channel is cached. It's discarded if it has no outputs.
+            if (try_cached(channel_name, channel_path, solo, *job, cache_key)) {
+                continue;
+            }
+            size_t output_idx =
+                job->add_output(channel_name, move(channel_path), move(cache_key));
+            if (drop_if_silent) {
+                job->set_drop_if_silent(output_idx);
+            }
+            outputs.push_back({job, output_idx});
+        }
+    }
+
+    // Loading the song and starting the player takes a while for each job, so soloed
+    // jobs do it on a worker thread once they run, while other jobs are rendering.
+    // The full job (and Metadata::make()) have already started every chip on this
+    // thread, so sound cores have initialized their global lookup tables before
+    // worker threads start them.
+    for (SoloOutput & out : solo_outputs) {
+        auto job_settings = settings;
+        job_settings.solo = out.solo;
+        // QSettings isn't thread-safe, so estimate the cost on this thread.
+        RenderJob * job = add_job(out.channel_name, Ok(RenderJob::make_deferred(
+            *full_job,
+            shared_metadata,
+            job_settings,
+            (float) job_cost(app_settings, metadata, out.solo))));
+        size_t output_idx = job->add_output(
+            out.channel_name, move(out.channel_path), move(out.cache_key));
+        if (out.drop_if_silent) {
+            job->set_drop_if_silent(output_idx);
+        }
+        outputs[out.output_idx] = {job, output_idx};
+    }
+
+    if (!errors.empty()) {
+        return errors;
+    }
+
+    if (mixed_master_idx) {
+        std::map<ChipId, uint8_t> solo_subchips;
+        for (SoloOutput const& out : solo_outputs) {
+            solo_subchips[out.solo.chip_id] |= (uint8_t) (1 << out.solo.subchip_idx);
+        }
+        bool const can_sum = !solo_outputs.empty()
+            && std::none_of(solo_subchips.begin(), solo_subchips.end(),
+                [&](auto const& pair) {
+                    auto it = full_subchips.find(pair.first);
+                    return it != full_subchips.end() && (it->second & pair.second);
+                });
+
+        if (!can_sum) {
+            // Every channel is recorded from the full job, so its output is master
+            // audio anyway (or a soloed chip was partly copied from the cache).
+            outputs[*mixed_master_idx] = {
+                full_job,
+                full_job->add_output(mixed_master_name, path, move(mixed_master_key)),
+            };
+        } else {
+            for (auto const& [chip_id, subchip_mask] : solo_subchips) {
+                full_job->disable_chip(chip_id, subchip_mask);
+            }
+
+            // Chips whose channels never play (ChannelActivity::Silent) aren't
+            // soloed, so they stay enabled in the full job. Unless every subchip was
+            // soloed, the full job contributes to master audio (and is started even
+            // if it records no channels), so the sum doesn't rely on the load-time
+            // scan being right.
+            std::map<ChipId, uint8_t> all_subchips;
+            for (FlatChannelMetadata const& channel : channels) {
+                if (channel.maybe_chip_id != NO_CHIP) {
+                    all_subchips[channel.maybe_chip_id] |=
+                        (uint8_t) (1 << channel.subchip_idx);
+                }
+            }
+            bool const full_job_audible = full_job->output_count() > 0
+                || std::any_of(metadata.chips.begin(), metadata.chips.end(),
+                    [&](ChipMetadata const& chip) {
+                        auto it = all_subchips.find(chip.chip_id);
+                        if (it == all_subchips.end()) {
+                            // A chip without channels can't be soloed.
+                            return true;
+                        }
+                        auto solo = solo_subchips.find(chip.chip_id);
+                        uint8_t soloed =
+                            solo != solo_subchips.end() ? solo->second : 0;
+                        return (it->second & ~soloed) != 0;
+                    });
+
+            std::vector<RenderJob *> contributors;
+            if (full_job_audible) {
+                contributors.push_back(full_job);
+            }
+            for (SoloOutput const& out : solo_outputs) {
+                contributors.push_back(outputs[out.output_idx].first);
+            }
+
+            auto output = RenderOutput {
+                .name = mixed_master_name,
+                .path = path,
+                .tap_idx = {},
+                .tap_channel = {},
+                .cache_key = move(mixed_master_key),
+            };
+            output.status.setProgressRange(0, full_job->duration());
+            output.status.setProgressValue(0);
+
+            auto mix = std::make_shared<StemMix>(move(output), contributors.size());
+            mix->make_fallback = [
+                song_data,
+                fallback_metadata = shared_metadata,
+                settings,
+                cost = (float) job_cost(app_settings, metadata, {}),
+                timings
+            ]() {
+                return RenderJob::make(
+                    song_data, *fallback_metadata, settings, cost, timings);
+            };
+            for (auto const& [i, job] : enumerate<size_t>(contributors)) {
+                job->set_mix(mix, i);
+            }
+
+            // The contributing jobs' handles already account for the time spent.
+            outputs[*mixed_master_idx] = {nullptr, cached_handles.size()};
+            cached_handles.push_back(RenderJobHandle {
+                .name = mixed_master_name,
+                .path = path,
+                .time_multiplier = 0,
+                .future = mix->output.status.future(),
+                .dropped = mix->output.dropped,
+            });
+        }
+    }
+
+    if (options.split_long_jobs) {
+        split_long_jobs(shared_metadata, settings, queued_jobs);
+    }
+
+    // Each RenderJobHandle's time_multiplier depends on the number of outputs in its
+    // job, so create handles after all outputs have been added.
+    for (auto const& [job, output_idx] : outputs) {
+        if (job) {
+            handles.push_back(job->future(output_idx));
+        } else {
+            handles.push_back(move(cached_handles[output_idx]));
+        }
+    }
+
+    return errors;
+}
+
+/// Starts render jobs with at least one output, and frees the rest.
+static void start_jobs(
+    std::vector<std::unique_ptr<RenderJob>> & queued_jobs, QThreadPool * pool
+) {
+    // Threads which are idle start jobs immediately, regardless of priority, so
+    // submit the most expensive jobs first.
+    std::stable_sort(
+        queued_jobs.begin(), queued_jobs.end(),
+        [](std::unique_ptr<RenderJob> const& a, std::unique_ptr<RenderJob> const& b) {
+            return a->cost() > b->cost();
+        });
+    for (auto & job : queued_jobs) {
+        // If no channels could be recorded from the full job, skip it.
+        if (!job->has_work()) {
+            continue;
+        }
+        job.release()->start_consume(pool);
+    }
+}
+
 Backend::Backend()
     : _settings(Settings::make())
     , _metadata(std::make_unique<Metadata>(Metadata {}))
+    , _render_cache(RenderCache::make())
+    , _render_timings(std::make_shared<TimingLog>())
 {
 }
 
-Settings & Backend::settings_mut(StateTransaction & tx) {
-    tx.settings_changed();
-    return _settings;
+std::optional<RenderCache> Backend::render_cache(RenderOptions const& options) const {
+    if (!options.use_cache) {
+        return {};
+    }
+    _render_cache.prune(RENDER_CACHE_SIZE);
+    return _render_cache;
 }
 
 Backend::~Backend() = default;
 
-QString Backend::load_path(StateTransaction & tx, QString const& path) {
+QString Backend::clear_render_cache() {
+    if (is_rendering()) {
+        return tr("Cannot clear the render cache while rendering");
+    }
+    _render_cache.clear();
+    return {};
+}
+
+QString Backend::load_path(
+    QString const& path, std::function<void()> const& before_replace
+) {
     if (is_rendering()) {
         return tr("Cannot load path while rendering");
     }
     _render_jobs.clear();
 
-    QByteArray file_data;
-
+    SongData song_data;
     {
-        auto file = QFile(path);
-        if (!file.open(QFile::ReadOnly)) {
-            return tr("Failed to open file: %1").arg(file.errorString());
-        }
-
-        qint64 size = file.size();
-        file_data = file.readAll();
-        if (file_data.size() != size) {
-            return tr("Failed to read file data, expected %1 bytes, read %2 bytes, error %3")
-                .arg(size)
-                .arg(file_data.size())
-                .arg(file.errorString());
+        // The GUI keeps the song loaded indefinitely, so read it rather than
+        // mapping it, to let other programs overwrite the file meanwhile.
+        auto result = read_song(path, false);
+        if (result.is_err()) {
+            return move(result.err_value());
         }
-        file.close();
+        song_data = move(result.value());
     }
 
     {
-        auto result = Metadata::make(file_data, _settings.app_settings());
+        auto result = Metadata::make(song_data.bytes, _settings.app_settings());
         if (result.is_err()) {
             return move(result.err_value());
         }
 
-        // We must call tx.file_replaced() (begin resetting chip/channel models) before
-        // overwriting _metadata (which holds the chip/channel lists).
-        tx.file_replaced();
+        // The GUI must begin resetting chip/channel models before we overwrite
+        // _metadata (which holds the chip/channel lists).
+        if (before_replace) {
+            before_replace();
+        }
 
-        _file_data = move(file_data);
+        _song_data = move(song_data);
         _metadata = move(result.value());
     }
 
@@ -715,7 +2448,8 @@ QString Backend::load_path(StateTransaction & tx, QString const& path) {
 }
 
 QString Backend::reload_settings() {
-    return _metadata->load_settings(_file_data, _settings.app_settings());
+    _metadata->load_settings(_settings.app_settings());
+    return {};
 }
 
 std::vector<ChipMetadata> const& Backend::chips() const {
@@ -781,7 +2515,40 @@ void Backend::cancel_render() {
     }
 }
 
-std::vector<QString> Backend::start_render(QString const& path) {
+void Backend::save_render_timings() {
+    std::vector<CoreTiming> timings;
+    {
+        auto lock = std::lock_guard(_render_timings->mutex);
+        std::swap(timings, _render_timings->timings);
+    }
+
+    // Sum up each core's timings across all jobs.
+    using Key = std::tuple<uint8_t, uint32_t, bool>;
+    std::map<Key, CoreTiming> totals;
+    for (CoreTiming const& timing : timings) {
+        auto key = Key(timing.type, timing.core, timing.solo);
+        auto [it, inserted] = totals.try_emplace(key, timing);
+        if (!inserted) {
+            it->second.chip_samples += timing.chip_samples;
+            it->second.seconds += timing.seconds;
+        }
+    }
+
+    for (auto const& [key, total] : totals) {
+        double speed = total.chip_samples / total.seconds;
+
+        // Average with the previous measurement, to smooth out noise (eg. from other
+        // programs running during a render).
+        if (auto prev = _settings.core_speed(total.type, total.core, total.solo)) {
+            speed = (speed + *prev) / 2;
+        }
+        _settings.set_core_speed(total.type, total.core, total.solo, speed);
+    }
+}
+
+std::vector<QString> Backend::start_render(
+    QString const& path, RenderOptions const& options
+) {
     if (is_rendering()) {
         return {tr("Cannot start render while render is active")};
     }
@@ -793,58 +2560,155 @@ std::vector<QString> Backend::start_render(QString const& path) {
 
     _render_thread_pool.setMaxThreadCount(cores);
 
-    std::vector<QString> errors;
     std::vector<std::unique_ptr<RenderJob>> queued_jobs;
+    std::vector<RenderJobHandle> handles;
 
-    for (auto const& [chan_idx, channel] : enumerate<size_t>(_metadata->flat_channels)) {
-        if (!channel.enabled) {
+    auto cache = render_cache(options);
+    auto errors = make_render_jobs(
+        _settings, _song_data, *_metadata, path, options, _render_timings, cache,
+        queued_jobs, handles);
+    if (!errors.empty()) {
+        return errors;
+    }
+
+    _render_jobs = move(handles);
+    start_jobs(queued_jobs, &_render_thread_pool);
+    return errors;
+}
+
+/// Estimates the memory used by every job rendering a file, before creating the
+/// jobs. Assumes every enabled channel needs its own job (rather than being recorded
+/// from the full job or copied from the render cache), but not that jobs are split
+/// into segments.
+static int64_t file_memory_estimate(
+    Metadata const& metadata, RenderOptions const& options, int64_t song_bytes
+) {
+    auto const noutput = (int64_t) std::count_if(
+        metadata.flat_channels.begin(), metadata.flat_channels.end(),
+        [](FlatChannelMetadata const& channel) { return channel.enabled; });
+    // A full job, plus one soloed job per channel.
+    int64_t const njob = noutput + 1;
+
+    int64_t bytes = song_bytes
+        + njob * player_memory(metadata)
+        + noutput * OUTPUT_MEMORY;
+
+    if (options.master_from_stems) {
+        // Master audio summed from channels is held in memory until every channel
+        // finishes.
+        uint32_t const sample_rate = options.sample_rate.value_or(metadata.sample_rate);
+        double seconds = metadata.loop_seconds > 0
+            ? metadata.song_seconds
+                + metadata.loop_seconds * (std::max(options.loop_count, 1u) - 1)
+                + options.fade_duration
+            : metadata.song_seconds + RenderSettings{}.unlooped_tail;
+        bytes += OUTPUT_MEMORY
+            + (int64_t) (seconds * sample_rate) * CHANNEL_COUNT * (int64_t) sizeof(int32_t);
+    }
+    return bytes;
+}
+
+std::vector<QString> Backend::render_batch(
+    std::vector<BatchItem> const& items,
+    RenderOptions const& options,
+    std::function<void(std::vector<FlatChannelMetadata> &)> const& select_channels,
+    int64_t memory_budget)
+{
+    if (is_rendering()) {
+        return {tr("Cannot start render while render is active")};
+    }
+
+    _render_jobs.clear();
+    _render_thread_pool.setMaxThreadCount(QThread::idealThreadCount());
+
+    auto budget = std::make_shared<MemoryBudget>(memory_budget);
+    auto cache = render_cache(options);
+    std::vector<QString> errors;
+
+    for (BatchItem const& item : items) {
+        auto const add_error = [&](QString const& err) {
+            errors.push_back(tr("Error rendering \"%1\": %2").arg(item.path, err));
+        };
+
+        // Each file is only mapped until its jobs finish.
+        auto maybe_song = read_song(item.path, true);
+        if (maybe_song.is_err()) {
+            add_error(maybe_song.err_value());
             continue;
         }
+        SongData song_data = move(maybe_song.value());
 
-        std::optional<SoloSettings> solo;
-        auto const channel_name = channel.numbered_name(chan_idx);
+        auto maybe_metadata = Metadata::make(song_data.bytes, _settings.app_settings());
+        if (maybe_metadata.is_err()) {
+            add_error(maybe_metadata.err_value());
+            continue;
+        }
+        Metadata & metadata = *maybe_metadata.value();
 
-        QString channel_path;
+        if (select_channels) {
+            select_channels(metadata.flat_channels);
+        }
 
-        // For per-channel jobs, solo the channel.
-        if (channel.maybe_chip_id != NO_CHIP) {
-            solo = SoloSettings {
-                .chip_id = channel.maybe_chip_id,
-                .subchip_idx = channel.subchip_idx,
-                .chan_idx = channel.chan_idx,
-            };
-            auto info = QFileInfo(path);
-            channel_path = info.dir()
-                .absoluteFilePath(QStringLiteral("%1 - %2.wav").arg(
-                    info.baseName(), channel_name
-                ));
-        } else {
-            channel_path = path;
+        // Creating jobs starts a player per job, so wait for earlier files' jobs to
+        // finish if this file doesn't fit in memory. Meanwhile, all CPU cores are
+        // rendering earlier files.
+        int64_t const reserved = file_memory_estimate(
+            metadata, options, (int64_t) song_data.bytes.size());
+        budget->acquire(reserved);
+
+        std::vector<std::unique_ptr<RenderJob>> queued_jobs;
+        std::vector<RenderJobHandle> handles;
+
+        auto job_errors = make_render_jobs(
+            _settings, song_data, metadata, item.render_path, options,
+            _render_timings, cache, queued_jobs, handles);
+        if (!job_errors.empty()) {
+            for (QString const& err : job_errors) {
+                add_error(err);
+            }
+            budget->release(reserved);
+            continue;
         }
 
-        auto settings = RenderSettings {
-            .solo = solo,
-            .sample_rate = _metadata->sample_rate,
-            .loop_count = 2,
-        };
-        auto job = RenderJob::make(
-            channel_name, move(channel_path), _file_data, *_metadata, settings
-        );
-        if (job.is_err()) {
-            errors.push_back(tr("Error rendering %1: %2")
-                .arg(channel_name, job.err_value()));
-        } else {
-            queued_jobs.push_back(move(job.value()));
+        // If no channels could be recorded from the full job, skip it.
+        queued_jobs.erase(
+            std::remove_if(
+                queued_jobs.begin(), queued_jobs.end(),
+                [](std::unique_ptr<RenderJob> const& job) {
+                    return !job->has_work();
+                }),
+            queued_jobs.end());
+
+        // Each job holds its own emulator and output buffers, and all jobs share the
+        // song data, which is freed once the last job finishes. Charge the song data
+        // to the most expensive job, which usually finishes last.
+        std::stable_sort(
+            queued_jobs.begin(), queued_jobs.end(),
+            [](std::unique_ptr<RenderJob> const& a, std::unique_ptr<RenderJob> const& b) {
+                return a->cost() > b->cost();
+            });
+        int64_t file_bytes = 0;
+        for (auto const& [i, job] : enumerate<size_t>(queued_jobs)) {
+            int64_t bytes =
+                job->memory_estimate() + (i == 0 ? song_data.bytes.size() : 0);
+            job->set_budget(budget, bytes);
+            file_bytes += bytes;
         }
-    }
 
-    if (!errors.empty()) {
-        return errors;
-    }
+        // Free this thread's reference to the song, so it's owned only by the jobs.
+        song_data = SongData();
 
-    for (auto & job : queued_jobs) {
-        _render_jobs.push_back(job->future());
-        job.release()->start_consume(&_render_thread_pool);
+        // Each job releases its own estimate when it finishes, so return the rest of
+        // the reservation (channels recorded from the full job or copied from the
+        // cache). If split segments need more than reserved, charge it without
+        // waiting, since the jobs have already been created.
+        budget->adjust(file_bytes - reserved);
+
+        for (RenderJobHandle & handle : handles) {
+            _render_jobs.push_back(move(handle));
+        }
+        start_jobs(queued_jobs, &_render_thread_pool);
     }
+
     return errors;
 }
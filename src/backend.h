@@ -1,6 +1,8 @@
 #pragma once
 
+#include "render_cache.h"
 #include "settings.h"
+#include "wave_writer.h"
 
 #include <player/playera.hpp>
 
@@ -9,11 +11,16 @@
 #include <QString>
 #include <QThreadPool>
 
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <vector>
 
+class QFile;
 struct Metadata;
+struct TimingLog;
 
 // It would be nice to have a relational view of data, so ChipMetadata and
 // FlatChannelMetadata would be separate tables, and nchan would be either
@@ -27,6 +34,20 @@ using ChipId = uint32_t;
 struct ChipMetadata {
     std::string name;
     ChipId chip_id;
+
+    /// The following fields are used to estimate how long a render takes.
+
+    /// DEVID_* value.
+    uint8_t type;
+
+    /// FCC of the emulation core, 0 if unknown.
+    uint32_t core;
+
+    /// Chip sampling rate, 0 if unknown.
+    uint32_t sample_rate;
+
+    /// Number of channels in the chip.
+    uint32_t nchan;
 };
 
 struct RenderJobHandle {
@@ -34,6 +55,27 @@ struct RenderJobHandle {
     QString path;
     float time_multiplier;
     QFuture<QString> future;
+
+    /// Set before the job finishes if every sample was zero, so the file at path was
+    /// deleted (see FlatChannelMetadata::activity). Shared with the job.
+    std::shared_ptr<std::atomic<bool>> dropped;
+
+    /// Returns whether the output was dropped for being silent. Only meaningful once
+    /// future is finished.
+    bool is_dropped() const {
+        return dropped && *dropped;
+    }
+};
+
+/// Whether a channel is used anywhere in the song, found by scanning the song's
+/// commands when loading it (without emulating any chips).
+enum class ChannelActivity : uint8_t {
+    /// The file format or chip isn't scanned, or the scan was inconclusive.
+    Unknown,
+    /// The channel is keyed on or given a nonzero volume.
+    Active,
+    /// The channel is never keyed on or given a nonzero volume.
+    Silent,
 };
 
 /// Uniquely identifies a channel in a .vgm file.
@@ -55,6 +97,11 @@ struct FlatChannelMetadata {
     /// and have chan_idx monotonically increasing from 0.
     uint8_t chan_idx;
 
+    /// Silent channels are disabled when the file is loaded. When rendered, Unknown
+    /// channels whose output is entirely silent are deleted, and their
+    /// RenderJobHandle::is_dropped() returns true.
+    ChannelActivity activity = ChannelActivity::Unknown;
+
     /// Whether to output the channel or not.
     bool enabled = true;
 
@@ -63,20 +110,98 @@ struct FlatChannelMetadata {
 
 constexpr ChipId NO_CHIP = (ChipId) -1;
 
+/// A loaded song file, decompressed if necessary. Copies share the same read-only
+/// data, so Metadata and all render jobs read the song without copying it.
+struct SongData {
+    /// The song's uncompressed contents. For uncompressed files rendered by
+    /// Backend::render_batch(), this wraps a memory mapping of the file
+    /// (QByteArray::fromRawData()) rather than a copy.
+    QByteArray bytes;
+
+    /// If set, owns the memory mapping pointed to by bytes.
+    std::shared_ptr<QFile> mapped_file;
+};
+
+/// A file to render in Backend::render_batch().
+struct BatchItem {
+    QString path;
+
+    /// Master audio is written to render_path, and channels are written next to it.
+    QString render_path;
+};
+
+/// Options which apply to a single render, and aren't saved in Settings.
+struct RenderOptions {
+    /// If set, overrides the sampling rate picked when loading the file.
+    std::optional<uint32_t> sample_rate;
+
+    /// Format of rendered .wav files. Sound cores render around 24 bits of precision,
+    /// which 16-bit output clips and rounds. Float32 keeps samples louder than full
+    /// scale, so loud channels can be mixed or normalized without re-rendering.
+    SampleFormat format = SampleFormat::Int16;
+
+    uint32_t loop_count = 2;
+
+    /// The fadeout duration for looped songs. In seconds.
+    float fade_duration = 4.0;
+
+    /// Whether to copy channels rendered previously with the same settings from the
+    /// render cache, and store newly rendered channels in it.
+    bool use_cache = true;
+
+    /// Whether to split channels which take much longer to render than others into
+    /// time segments rendered in parallel. Segments start with a seek and a short
+    /// warm-up, so audio near segment boundaries may differ slightly from an unsplit
+    /// render.
+    bool split_long_jobs = false;
+
+    /// Whether to sum master audio from the channels being rendered, rather than
+    /// rendering it by emulating every chip at once (which is often the slowest job).
+    /// Only used if every channel is rendered and every chip's output is the sum of its
+    /// channels. The sum may differ from a full render by a few steps of rounding. If a
+    /// channel clips, master audio is rendered as usual once the channels finish.
+    /// Only used with 16-bit output.
+    bool master_from_stems = false;
+
+    /// Whether to copy later passes through a song's loop instead of emulating them,
+    /// if the first two passes render identical audio. This is approximate: chip state
+    /// which doesn't affect the audio isn't compared, so the fade-out may differ
+    /// slightly from a full render. Only used if loop_count is at least 3, and only by
+    /// jobs which emulate every chip unmuted (channels rendered by soloed jobs are
+    /// emulated in full). Channels with copied passes aren't stored in the render
+    /// cache.
+    bool copy_loops = false;
+};
+
 class StateTransaction;
 class Backend {
     Q_DECLARE_TR_FUNCTIONS(Backend)
 
+public:
+    /// Files in the render cache beyond this size are deleted, least recently used
+    /// first.
+    static constexpr int64_t RENDER_CACHE_SIZE = int64_t(4) << 30;
+
+private:
     /// Whether the GUI is being updated in response to events.
     bool _during_update = false;
 
     Settings _settings;
-    QByteArray _file_data;
+    /// The loaded file, decompressed if necessary. Shared with render jobs.
+    SongData _song_data;
     std::unique_ptr<Metadata> _metadata;
+    RenderCache _render_cache;
     QThreadPool _render_thread_pool;
     std::vector<RenderJobHandle> _render_jobs;
+    std::shared_ptr<TimingLog> _render_timings;
 
     friend class StateTransaction;
+
+private:
+    /// Returns the render cache (after deleting old entries), or nullopt if
+    /// options disables caching.
+    std::optional<RenderCache> render_cache(RenderOptions const& options) const;
+
 public:
     Backend();
     ~Backend();
@@ -84,10 +209,17 @@ public:
     Settings const& settings() const {
         return _settings;
     }
+    /// Defined in mainwindow.cpp.
     Settings & settings_mut(StateTransaction & tx);
 
-    /// If non-empty, holds error message.
+    /// If non-empty, holds error message. Defined in mainwindow.cpp.
     [[nodiscard]] QString load_path(StateTransaction & tx, QString const& path);
+    /// Loads a file without a GUI. If the file is loaded successfully,
+    /// before_replace() is called before the current chips and channels are replaced.
+    /// If non-empty, holds error message.
+    [[nodiscard]] QString load_path(
+        QString const& path, std::function<void()> const& before_replace = {}
+    );
     /// If non-empty, holds error message.
     [[nodiscard]] QString reload_settings();
 
@@ -109,11 +241,44 @@ public:
     /// Returns whether there are unfinished render jobs.
     bool is_rendering() const;
 
+    /// Returns the render cache (RenderOptions::use_cache), to show its size and
+    /// location.
+    RenderCache const& render_cache_files() const {
+        return _render_cache;
+    }
+
+    /// Deletes every file in the render cache. If non-empty, holds error message.
+    [[nodiscard]] QString clear_render_cache();
+
     /// Cancel all active render jobs.
     void cancel_render();
 
+    /// Save the emulation speed measured by finished render jobs to settings, to
+    /// estimate the duration of future renders. Call once all render jobs finish.
+    void save_render_timings();
+
     /// Returns empty vector if succeeded, a message if a render is in progress,
     /// or messages if starting the render fails.
-    [[nodiscard]] std::vector<QString> start_render(QString const& path);
+    [[nodiscard]] std::vector<QString> start_render(
+        QString const& path, RenderOptions const& options = {}
+    );
+
+    /// Renders many files in a single thread pool, so jobs from later files keep CPU
+    /// cores busy while earlier files finish. Does not change the loaded file.
+    ///
+    /// After loading each file, select_channels() can enable or disable channels.
+    /// Blocks until every file's jobs have been started. Before creating each file's
+    /// jobs, waits for earlier jobs to finish until the estimated memory used by
+    /// active jobs (based on each file's chips and data blocks) fits within
+    /// memory_budget (in bytes).
+    ///
+    /// Returns errors loading files or creating jobs (those files are skipped).
+    /// Errors while rendering are reported through render_jobs().
+    [[nodiscard]] std::vector<QString> render_batch(
+        std::vector<BatchItem> const& items,
+        RenderOptions const& options,
+        std::function<void(std::vector<FlatChannelMetadata> &)> const& select_channels,
+        int64_t memory_budget
+    );
 };
 
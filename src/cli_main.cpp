@@ -0,0 +1,318 @@
+/// Renders files without a GUI, for batch exports on machines without a display.
+
+#include "backend.h"
+#include "lib/enumerate.h"
+#include "lib/gtr.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>  // std::any_of
+#include <cstdio>
+#include <map>
+
+static QString help_text(QCommandLineParser & parser) {
+    return parser.helpText();
+}
+
+[[noreturn]] static void bail_help(QCommandLineParser & parser, QString error) {
+    fprintf(stderr, "%s\n\n%s",
+        error.toUtf8().data(),
+        help_text(parser).toUtf8().data());
+    exit(1);
+}
+
+[[noreturn]] static void help_and_exit(QCommandLineParser & parser) {
+    fputs(help_text(parser).toUtf8().data(), stdout);
+    exit(0);
+}
+
+static void print_error(QString const& error) {
+    fprintf(stderr, "%s\n", error.toUtf8().data());
+}
+
+struct Arguments {
+    QStringList filenames;
+
+    /// If empty, each .wav file is written next to its input file.
+    QString output_dir;
+
+    RenderOptions options;
+
+    /// If non-empty, only render channels whose name contains any of these strings.
+    QStringList channel_filters;
+
+    /// Bytes of memory which queued and active render jobs may use.
+    int64_t memory_budget;
+
+    /// May exit if invalid arguments, --help, or --version is passed.
+    [[nodiscard]]
+    static Arguments parse_or_exit(QStringList const& arguments) {
+        QCommandLineParser parser;
+
+        // Prepare the argument list.
+        parser.setApplicationDescription(
+            gtr("cli", "Renders each channel of .vgm files to separate .wav files."));
+        parser.addHelpOption();
+        parser.addVersionOption();
+        parser.addPositionalArgument(
+            "FILES", gtr("cli", ".vgm files to render."), "FILES...");
+
+        auto output_dir = QCommandLineOption(
+            {"o", "output-dir"},
+            gtr("cli", "Write .wav files to DIR (default: next to each input file)."),
+            "DIR");
+        parser.addOption(output_dir);
+
+        auto sample_rate = QCommandLineOption(
+            {"r", "rate"},
+            gtr("cli", "Sampling rate in Hz (default: from settings)."),
+            "HZ");
+        parser.addOption(sample_rate);
+
+        auto sample_format = QCommandLineOption(
+            "format",
+            gtr("cli",
+                "Sample format of .wav files: s16, s24, or f32 (default: s16). f32 "
+                "files are not clipped, and keep audio louder than full scale."),
+            "FORMAT");
+        parser.addOption(sample_format);
+
+        auto loop_count = QCommandLineOption(
+            {"l", "loops"},
+            gtr("cli", "Number of times to play looped songs (default: 2)."),
+            "N");
+        parser.addOption(loop_count);
+
+        auto fade = QCommandLineOption(
+            {"f", "fade"},
+            gtr("cli", "Fadeout duration of looped songs in seconds (default: 4)."),
+            "SECONDS");
+        parser.addOption(fade);
+
+        auto channel = QCommandLineOption(
+            {"c", "channel"},
+            gtr("cli",
+                "Only render channels whose name contains NAME (case-insensitive). "
+                "May be repeated. Master audio is named \"Master Audio\"."),
+            "NAME");
+        parser.addOption(channel);
+
+        auto no_cache = QCommandLineOption(
+            "no-cache",
+            gtr("cli", "Render every channel, even if it was rendered before with the "
+                "same settings."));
+        parser.addOption(no_cache);
+
+        auto split_long_jobs = QCommandLineOption(
+            "split-long-jobs",
+            gtr("cli",
+                "Render slow channels as several time segments in parallel. Faster on "
+                "many-core machines, but audio near segment boundaries may differ "
+                "slightly. Split channels are not cached."));
+        parser.addOption(split_long_jobs);
+
+        auto master_from_stems = QCommandLineOption(
+            "master-from-stems",
+            gtr("cli",
+                "Sum master audio from the rendered channels instead of rendering it "
+                "separately, when every channel is rendered and every chip's output "
+                "is the sum of its channels. Summed master audio may differ slightly "
+                "from a full render, and is not cached."));
+        parser.addOption(master_from_stems);
+
+        auto copy_loops = QCommandLineOption(
+            "copy-loops",
+            gtr("cli",
+                "When a song loops 3 or more times and its first two loops render "
+                "the same audio, copy later loops instead of rendering them. This is "
+                "approximate: chip state which doesn't change the audio isn't compared, "
+                "so fade-outs may differ slightly from a full render. Channels which "
+                "must be soloed are rendered in full. Channels with copied loops are "
+                "not cached."));
+        parser.addOption(copy_loops);
+
+        auto memory = QCommandLineOption(
+            {"m", "memory"},
+            gtr("cli",
+                "Approximate memory used by queued renders in MiB (default: 1024). "
+                "Rendering waits for earlier files to finish if this is exceeded."),
+            "MIB");
+        parser.addOption(memory);
+
+        // Parse the arguments.
+        // May exit if invalid arguments, --help, or --version is passed.
+        if (!parser.parse(arguments)) {
+            bail_help(parser, QStringLiteral("%1: %2").arg(
+                gtr("cli", "error"),
+                parser.errorText()));
+        }
+        if (parser.isSet(QStringLiteral("version"))) {
+            // Exits the program.
+            parser.showVersion();
+        }
+        if (parser.isSet(QStringLiteral("help"))) {
+            help_and_exit(parser);
+        }
+
+        Arguments out{};
+        out.filenames = parser.positionalArguments();
+        if (out.filenames.isEmpty()) {
+            bail_help(parser, gtr("cli", "No input files, expected FILES"));
+        }
+
+        out.output_dir = parser.value(output_dir);
+
+        if (parser.isSet(sample_rate)) {
+            bool ok;
+            uint rate = parser.value(sample_rate).toUInt(&ok);
+            if (!ok || rate == 0) {
+                bail_help(parser, gtr("cli", "Invalid sampling rate \"%1\"")
+                    .arg(parser.value(sample_rate)));
+            }
+            out.options.sample_rate = rate;
+        }
+        if (parser.isSet(sample_format)) {
+            QString value = parser.value(sample_format).toLower();
+            if (value == QStringLiteral("s16")) {
+                out.options.format = SampleFormat::Int16;
+            } else if (value == QStringLiteral("s24")) {
+                out.options.format = SampleFormat::Int24;
+            } else if (value == QStringLiteral("f32")) {
+                out.options.format = SampleFormat::Float32;
+            } else {
+                bail_help(parser, gtr("cli", "Invalid sample format \"%1\"")
+                    .arg(parser.value(sample_format)));
+            }
+        }
+        if (parser.isSet(loop_count)) {
+            bool ok;
+            uint loops = parser.value(loop_count).toUInt(&ok);
+            if (!ok || loops == 0) {
+                bail_help(parser, gtr("cli", "Invalid loop count \"%1\"")
+                    .arg(parser.value(loop_count)));
+            }
+            out.options.loop_count = loops;
+        }
+        if (parser.isSet(fade)) {
+            bool ok;
+            float seconds = parser.value(fade).toFloat(&ok);
+            if (!ok || !(seconds >= 0)) {
+                bail_help(parser, gtr("cli", "Invalid fade duration \"%1\"")
+                    .arg(parser.value(fade)));
+            }
+            out.options.fade_duration = seconds;
+        }
+        out.channel_filters = parser.values(channel);
+        out.options.use_cache = !parser.isSet(no_cache);
+        out.options.split_long_jobs = parser.isSet(split_long_jobs);
+        out.options.master_from_stems = parser.isSet(master_from_stems);
+        out.options.copy_loops = parser.isSet(copy_loops);
+
+        out.memory_budget = int64_t(1024) << 20;
+        if (parser.isSet(memory)) {
+            bool ok;
+            uint mib = parser.value(memory).toUInt(&ok);
+            if (!ok || mib == 0) {
+                bail_help(parser, gtr("cli", "Invalid memory limit \"%1\"")
+                    .arg(parser.value(memory)));
+            }
+            out.memory_budget = int64_t(mib) << 20;
+        }
+
+        return out;
+    }
+};
+
+static void select_channels(
+    QStringList const& filters, std::vector<FlatChannelMetadata> & channels
+) {
+    if (filters.isEmpty()) {
+        return;
+    }
+    for (auto const& [row, channel] : enumerate<size_t>(channels)) {
+        auto name = channel.numbered_name(row);
+        channel.enabled = std::any_of(
+            filters.begin(), filters.end(),
+            [&name](QString const& filter) {
+                return name.contains(filter, Qt::CaseInsensitive);
+            });
+    }
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+    // Share settings (sampling rate, measured core speeds) and the render cache with
+    // the GUI, which are stored under the application name.
+    QCoreApplication::setApplicationName("qvgmsplit");
+
+    // Parse command-line arguments.
+    // May exit if invalid arguments, --help, or --version is passed.
+    auto arg = Arguments::parse_or_exit(QCoreApplication::arguments());
+
+    if (!arg.output_dir.isEmpty() && !QDir().mkpath(arg.output_dir)) {
+        print_error(gtr("cli", "Failed to create output directory \"%1\"")
+            .arg(arg.output_dir));
+        return 1;
+    }
+
+    bool ok = true;
+
+    // Files rendered to the same path would overwrite each other's master audio and
+    // channels, so only render the first of them.
+    std::vector<BatchItem> items;
+    std::map<QString, QString> render_path_to_input;
+    for (QString const& path : arg.filenames) {
+        auto info = QFileInfo(path);
+        auto dir = arg.output_dir.isEmpty() ? info.dir() : QDir(arg.output_dir);
+        auto render_path =
+            dir.absoluteFilePath(info.completeBaseName() + QStringLiteral(".wav"));
+
+        auto [it, inserted] = render_path_to_input.try_emplace(render_path, path);
+        if (!inserted) {
+            print_error(gtr("cli", "Skipping \"%1\", which would overwrite \"%2\" "
+                "rendered from \"%3\"").arg(path, render_path, it->second));
+            ok = false;
+            continue;
+        }
+        items.push_back(BatchItem {
+            .path = path,
+            .render_path = render_path,
+        });
+    }
+
+    // Queue every file's jobs in one thread pool, so cores don't sit idle while the
+    // last jobs of each file finish.
+    Backend backend;
+    auto errors = backend.render_batch(
+        items,
+        arg.options,
+        [&arg](std::vector<FlatChannelMetadata> & channels) {
+            select_channels(arg.channel_filters, channels);
+        },
+        arg.memory_budget);
+
+    ok = ok && errors.empty();
+    for (QString const& err : errors) {
+        print_error(err);
+    }
+
+    for (RenderJobHandle const& job : backend.render_jobs()) {
+        // Each job reports a result only if rendering fails.
+        auto future = job.future;
+        future.waitForFinished();
+        if (future.isResultReadyAt(0)) {
+            print_error(gtr("cli", "Error rendering \"%1\": %2")
+                .arg(job.path, future.resultAt(0)));
+            ok = false;
+        } else if (!job.is_dropped()) {
+            // Silent channels are deleted, so only list files which were written.
+            printf("%s\n", job.path.toUtf8().data());
+        }
+    }
+
+    backend.save_render_timings();
+    return ok ? 0 : 1;
+}
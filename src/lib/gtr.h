@@ -1 +1,14 @@
 #pragma once
+
+#include <QCoreApplication>
+#include <QString>
+
+/// Translate a string in a global context, outside of a class.
+inline QString gtr(
+    const char *context,
+    const char *sourceText,
+    const char *disambiguation = nullptr,
+    int n = -1)
+{
+    return QCoreApplication::translate(context, sourceText, disambiguation, n);
+}
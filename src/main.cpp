@@ -1,5 +1,6 @@
 #include "mainwindow.h"
 #include "gui_app.h"
+#include "lib/gtr.h"
 
 #include <QApplication>
 #include <QCommandLineParser>
@@ -8,17 +9,6 @@ struct ReturnCode {
     int value;
 };
 
-// TODO put in header
-/// Translate a string in a global context, outside of a class.
-static QString gtr(
-    const char *context,
-    const char *sourceText,
-    const char *disambiguation = nullptr,
-    int n = -1)
-{
-    return QCoreApplication::translate(context, sourceText, disambiguation, n);
-}
-
 static bool has(std::string const& s) {
     return !s.empty();
 }
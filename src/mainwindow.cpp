@@ -29,7 +29,9 @@
 #include <QErrorMessage>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QGuiApplication>
 #include <QKeyEvent>
+#include <QPalette>
 #include <QTextCursor>
 #include <QTextDocument>
 
@@ -353,6 +355,21 @@ public:
         case Qt::CheckStateRole:
             return channels[row].enabled ? Qt::Checked : Qt::Unchecked;
 
+        // Gray out channels which the song never uses (which are unchecked when
+        // loading the file).
+        case Qt::ForegroundRole:
+            if (channels[row].activity == ChannelActivity::Silent) {
+                return QGuiApplication::palette().color(
+                    QPalette::Disabled, QPalette::Text);
+            }
+            return {};
+
+        case Qt::ToolTipRole:
+            if (channels[row].activity == ChannelActivity::Silent) {
+                return MainWindow::tr("The song never plays this channel.");
+            }
+            return {};
+
         default: return {};
         }
     }
@@ -700,7 +717,9 @@ public:
             return;
         }
 
-        auto err = _backend.start_render(render_path);
+        RenderOptions options;
+        options.use_cache = _backend.settings().app_settings().use_render_cache;
+        auto err = _backend.start_render(render_path, options);
         if (!err.empty()) {
             // In practice this never happens; the only errors that are reported
             // immediately are "already rendering" (the Render action is disabled
@@ -839,6 +858,15 @@ StateTransaction::~StateTransaction() noexcept(false) {
     }
 }
 
+Settings & Backend::settings_mut(StateTransaction & tx) {
+    tx.settings_changed();
+    return _settings;
+}
+
+QString Backend::load_path(StateTransaction & tx, QString const& path) {
+    return load_path(path, [&tx] { tx.file_replaced(); });
+}
+
 Backend const& StateTransaction::state() const {
     return _win->_backend;
 }
@@ -5,6 +5,9 @@
 
 #include <QCheckBox>
 #include <QDialogButtonBox>
+#include <QDir>
+#include <QLocale>
+#include <QMessageBox>
 #include <QPushButton>
 #include <QSpinBox>
 
@@ -19,6 +22,8 @@ private:
 
     QSpinBox * _sample_rate;
     QCheckBox * _use_chip_rate;
+    QCheckBox * _use_render_cache;
+    QPushButton * _clear_render_cache;
 
     QPushButton * _ok;
     QPushButton * _cancel;
@@ -45,6 +50,12 @@ public:
             {form__w(QCheckBox(tr("Use native chip sample rate")));
                 _use_chip_rate = w;
             }
+            {form__w(QCheckBox(tr("Reuse channels rendered before with the same settings")));
+                _use_render_cache = w;
+            }
+            {form__w(QPushButton);
+                _clear_render_cache = w;
+            }
         }
         {l__w(QDialogButtonBox);
             _ok = w->addButton(QDialogButtonBox::Ok);
@@ -65,6 +76,26 @@ public:
                 _app.use_chip_rate = use_chip_rate;
             });
 
+        auto const& cache = _backend->render_cache_files();
+        _use_render_cache->setChecked(_app.use_render_cache);
+        _use_render_cache->setEnabled(!cache.dir().isEmpty());
+        _use_render_cache->setToolTip(
+            tr("Rendered channels are copied to %1, and the least recently used are "
+                "deleted once it holds more than %2.")
+                .arg(
+                    QDir::toNativeSeparators(cache.dir()),
+                    locale().formattedDataSize(Backend::RENDER_CACHE_SIZE)));
+        connect(
+            _use_render_cache, &QCheckBox::toggled,
+            this, [this](bool use_render_cache) {
+                _app.use_render_cache = use_render_cache;
+            });
+
+        update_clear_render_cache();
+        connect(
+            _clear_render_cache, &QPushButton::clicked,
+            this, &OptionsDialogImpl::clear_render_cache);
+
         connect(
             _ok, &QPushButton::clicked,
             this, &OptionsDialogImpl::ok);
@@ -73,6 +104,20 @@ public:
             this, &OptionsDialogImpl::cancel);
     }
 
+    void update_clear_render_cache() {
+        int64_t size = _backend->render_cache_files().size();
+        _clear_render_cache->setText(
+            tr("Clear Render Cache (%1)").arg(locale().formattedDataSize(size)));
+        _clear_render_cache->setEnabled(size > 0);
+    }
+
+    void clear_render_cache() {
+        if (auto err = _backend->clear_render_cache(); !err.isEmpty()) {
+            QMessageBox::warning(this, tr("Error"), err);
+        }
+        update_clear_render_cache();
+    }
+
     void ok() {
         // Perhaps factor out into apply()?
         auto tx = _main->edit_unwrap();
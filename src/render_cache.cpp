@@ -0,0 +1,206 @@
+#include "render_cache.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <system_error>
+#include <utility>  // std::move
+#include <vector>
+
+namespace fs = std::filesystem;
+using std::move;
+
+RenderCache::RenderCache(QString dir)
+    : _dir(move(dir))
+{}
+
+RenderCache RenderCache::make() {
+    auto dir = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+        .absoluteFilePath(QStringLiteral("renders"));
+    if (!QDir().mkpath(dir)) {
+        return RenderCache({});
+    }
+    return RenderCache(move(dir));
+}
+
+static QString entry_path(QString const& dir, QByteArray const& key) {
+    return QDir(dir).absoluteFilePath(QString::fromLatin1(key.toHex() + ".wav"));
+}
+
+/// An empty file recording that a render was entirely silent, and no .wav file was
+/// kept.
+static QString silent_path(QString const& dir, QByteArray const& key) {
+    return QDir(dir).absoluteFilePath(QString::fromLatin1(key.toHex() + ".silent"));
+}
+
+/// An empty file next to a cache entry, whose modification time records when the
+/// entry was last used. (Copying an entry to an output file doesn't change the entry's
+/// own modification time.)
+static QString stamp_path(QString const& entry_path) {
+    return entry_path + QStringLiteral(".used");
+}
+
+/// Marks a cache entry as recently used, so prune() keeps it.
+static void touch_stamp(QString const& entry_path) {
+    auto stamp = stamp_path(entry_path);
+    QFile file(stamp);
+    if (!file.open(QFile::WriteOnly)) {
+        return;
+    }
+    file.close();
+
+    std::error_code ec;
+    fs::last_write_time(
+        fs::path(stamp.toStdWString()), fs::file_time_type::clock::now(), ec);
+}
+
+/// Copies src to dest, which must not exist. Cache entries are never shared with
+/// output files (for example through hard links), so editing an output in place
+/// can't change the cached audio.
+static bool copy_file(QString const& src, QString const& dest) {
+    std::error_code ec;
+    return fs::copy_file(
+        fs::path(src.toStdWString()), fs::path(dest.toStdWString()), ec) && !ec;
+}
+
+bool RenderCache::fetch(QByteArray const& key, QString const& dest) const {
+    if (_dir.isEmpty()) {
+        return false;
+    }
+    auto path = entry_path(_dir, key);
+    if (!QFileInfo::exists(path)) {
+        return false;
+    }
+
+    if (QFileInfo::exists(dest) && !QFile::remove(dest)) {
+        return false;
+    }
+    if (!copy_file(path, dest)) {
+        QFile::remove(dest);
+        return false;
+    }
+
+    touch_stamp(path);
+    return true;
+}
+
+void RenderCache::store(QByteArray const& key, QString const& src) const {
+    if (_dir.isEmpty()) {
+        return;
+    }
+    auto path = entry_path(_dir, key);
+
+    // Copy to a temporary name and rename it into place, so other processes never
+    // see a partially copied entry. Render threads in this process may store the same
+    // key at once, so each call gets its own temporary name.
+    static std::atomic<uint64_t> next_tmp_id = 0;
+    auto tmp_path = QStringLiteral("%1.%2-%3.tmp")
+        .arg(path)
+        .arg(QCoreApplication::applicationPid())
+        .arg(next_tmp_id++);
+    QFile::remove(tmp_path);
+    if (!copy_file(src, tmp_path)) {
+        QFile::remove(tmp_path);
+        return;
+    }
+
+    std::error_code ec;
+    fs::rename(fs::path(tmp_path.toStdWString()), fs::path(path.toStdWString()), ec);
+    if (ec) {
+        QFile::remove(tmp_path);
+        return;
+    }
+    touch_stamp(path);
+}
+
+bool RenderCache::is_silent(QByteArray const& key) const {
+    if (_dir.isEmpty()) {
+        return false;
+    }
+    auto path = silent_path(_dir, key);
+    if (!QFileInfo::exists(path)) {
+        return false;
+    }
+    touch_stamp(path);
+    return true;
+}
+
+void RenderCache::store_silent(QByteArray const& key) const {
+    if (_dir.isEmpty()) {
+        return;
+    }
+    auto path = silent_path(_dir, key);
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly)) {
+        return;
+    }
+    file.close();
+    touch_stamp(path);
+}
+
+void RenderCache::prune(int64_t max_bytes) const {
+    if (_dir.isEmpty()) {
+        return;
+    }
+
+    struct Entry {
+        QString path;
+        int64_t size;
+        QDateTime last_used;
+    };
+    // Silent markers take no space, but are pruned along with older entries.
+    auto infos = QDir(_dir).entryInfoList(
+        {QStringLiteral("*.wav"), QStringLiteral("*.silent")}, QDir::Files);
+    std::vector<Entry> entries;
+    for (QFileInfo const& info : infos) {
+        auto path = info.absoluteFilePath();
+        entries.push_back(Entry {
+            .path = path,
+            .size = info.size(),
+            .last_used = QFileInfo(stamp_path(path)).lastModified(),
+        });
+    }
+
+    // Most recently used first.
+    std::stable_sort(entries.begin(), entries.end(), [](Entry const& a, Entry const& b) {
+        return a.last_used > b.last_used;
+    });
+
+    int64_t total = 0;
+    for (Entry const& entry : entries) {
+        total += entry.size;
+        if (total > max_bytes) {
+            QFile::remove(entry.path);
+            QFile::remove(stamp_path(entry.path));
+        }
+    }
+}
+
+int64_t RenderCache::size() const {
+    if (_dir.isEmpty()) {
+        return 0;
+    }
+    int64_t total = 0;
+    auto infos = QDir(_dir).entryInfoList(QDir::Files);
+    for (QFileInfo const& info : infos) {
+        total += info.size();
+    }
+    return total;
+}
+
+void RenderCache::clear() const {
+    if (_dir.isEmpty()) {
+        return;
+    }
+    auto infos = QDir(_dir).entryInfoList(QDir::Files);
+    for (QFileInfo const& info : infos) {
+        QFile::remove(info.absoluteFilePath());
+    }
+}
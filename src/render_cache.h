@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstdint>
+
+/// Stores finished .wav files, keyed by a hash of everything which affects their
+/// contents (computed by the caller). Re-rendering a song after changing which
+/// channels are enabled can then reuse the unchanged channels.
+///
+/// Cached files are copied to and from output files, so programs which edit an output
+/// file in place don't change the cache.
+class RenderCache {
+    /// If empty, caching is disabled.
+    QString _dir;
+
+private:
+    RenderCache(QString dir);
+
+public:
+    /// Uses a subfolder of the user's cache directory. If it can't be created,
+    /// returns a cache which never stores files.
+    static RenderCache make();
+
+    /// If key is cached, replaces dest with the cached file and returns true.
+    bool fetch(QByteArray const& key, QString const& dest) const;
+
+    /// Adds a finished render to the cache. Errors are ignored.
+    void store(QByteArray const& key, QString const& src) const;
+
+    /// Returns whether key was rendered before, and every sample was zero so no file
+    /// was kept.
+    bool is_silent(QByteArray const& key) const;
+
+    /// Records that the render for key was entirely silent. Errors are ignored.
+    void store_silent(QByteArray const& key) const;
+
+    /// Deletes the least recently used files until the cache is smaller than
+    /// max_bytes.
+    void prune(int64_t max_bytes) const;
+
+    /// The folder holding cached files, or empty if caching is disabled.
+    QString const& dir() const {
+        return _dir;
+    }
+
+    /// Returns the total size of cached files in bytes.
+    int64_t size() const;
+
+    /// Deletes every cached file.
+    void clear() const;
+};
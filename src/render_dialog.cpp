@@ -16,6 +16,7 @@
 #include <QAbstractTableModel>
 
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFutureWatcher>
 #include <QKeyEvent>
 #include <QPointer>
@@ -29,6 +30,9 @@ static QString format_duration(int seconds) {
         .arg(seconds % 60, 2, 10, QLatin1Char('0'));
 }
 
+/// QProgressBar only accepts integers, so scale progress to [0..PROGRESS_RANGE].
+static constexpr int PROGRESS_RANGE = 10000;
+
 struct ProgressState {
     int curr;
     int max;
@@ -36,6 +40,8 @@ struct ProgressState {
     bool finished;
     bool error;
     bool canceled;
+    /// The output was silent, so its file was deleted.
+    bool dropped;
 };
 
 class JobModel : public QAbstractTableModel {
@@ -130,6 +136,9 @@ public:
             switch (role) {
             case Qt::DisplayRole: {
                 auto const& progress = _progress[(size_t) row];
+                if (progress.dropped) {
+                    return tr("Silent, not saved");
+                }
                 return tr("%1%, %2/%3")
                     .arg(progress.curr * 100 / progress.max)
                     .arg(format_duration(progress.curr), format_duration(progress.max));
@@ -164,6 +173,7 @@ static std::vector<ProgressState> get_progress(Backend * backend) {
             .finished = job.future.isFinished(),
             .error = job.future.isResultReadyAt(0),
             .canceled = job.future.isCanceled(),
+            .dropped = job.is_dropped(),
         });
     }
 
@@ -181,6 +191,7 @@ private:
     QPushButton * _cancel_close;
 
     QTimer _status_timer;
+    QElapsedTimer _elapsed;
     bool _is_done = false;
     bool _has_errors = false;
     bool _close_on_end = false;
@@ -253,8 +264,6 @@ RenderDialogImpl::RenderDialogImpl(Backend * backend, QWidget * parent)
         _cancel_close = w;
     }
 
-    int total_progress = 0;
-
     for (auto const& job : _backend->render_jobs()) {
         auto watch = new QFutureWatcher<QString>(this);
         connect(
@@ -270,10 +279,10 @@ RenderDialogImpl::RenderDialogImpl(Backend * backend, QWidget * parent)
         // "To avoid a race condition, it is important to call this function *after*
         // doing the connections."
         watch->setFuture(job.future);
-        total_progress += job.future.progressMaximum();
     }
 
-    _progress->setMaximum(total_progress);
+    _progress->setMaximum(PROGRESS_RANGE);
+    _elapsed.start();
 
     // Connect GUI.
     connect(
@@ -301,15 +310,24 @@ void RenderDialogImpl::update_status() {
     bool all_finished = true;
     bool any_error = false;
     bool any_canceled = false;
-    int curr_progress = 0;
-    int max_progress = 0;
 
-    for (auto const& job : job_progress) {
-        curr_progress += (int) ((double) job.time_multiplier * (double) job.curr);
+    // Progress in seconds of audio, weighted by each job's estimated CPU time per
+    // second, so the progress bar advances at a steady rate.
+    double curr_progress = 0;
+    double max_progress = 0;
+
+    // Unweighted progress in seconds of audio.
+    int curr_time = 0;
+    int max_time = 0;
 
+    for (auto const& job : job_progress) {
         // Treat errored jobs as completed (max := curr).
         int job_max = job.error ? job.curr : job.max;
-        max_progress += (int) ((double) job.time_multiplier * (double) job_max);
+
+        curr_progress += (double) job.time_multiplier * (double) job.curr;
+        max_progress += (double) job.time_multiplier * (double) job_max;
+        curr_time += job.curr;
+        max_time += job_max;
 
         if (job.error) {
             any_error = true;
@@ -323,11 +341,18 @@ void RenderDialogImpl::update_status() {
     }
 
     // Set the progress bar.
-    if (max_progress == 0) {
-        curr_progress = max_progress = 1;
+    double fraction = max_progress > 0 ? curr_progress / max_progress : 1.;
+    _progress->setValue((int) (fraction * PROGRESS_RANGE));
+
+    // Estimate the remaining time, once enough progress has been made to extrapolate.
+    if (!all_finished && fraction >= 0.01) {
+        auto elapsed = (double) _elapsed.elapsed() / 1000.;
+        auto remaining = (int) (elapsed * (1. - fraction) / fraction);
+        _progress->setFormat(
+            tr("%p%, %1 remaining").arg(format_duration(remaining)));
+    } else {
+        _progress->setFormat(QStringLiteral("%p%"));
     }
-    _progress->setMaximum(max_progress);
-    _progress->setValue(curr_progress);
 
     // Update the job list.
     _model->set_progress(job_progress);
@@ -360,20 +385,21 @@ void RenderDialogImpl::update_status() {
         _has_errors = any_error;
         _status_timer.stop();
 
+        _backend->save_render_timings();
+
         // If a render job isn't canceled (runs to completion or hits an error), set
         // the progress bar to 100%. If it runs to completion, warn if there's a time
         // mismatch.
         if (!any_canceled) {
-            int max_progress = _progress->maximum();
-            if (!any_error && curr_progress != max_progress) {
+            if (!any_error && curr_time != max_time) {
                 _error_log->appendPlainText(
                     tr("Warning: total rendered time of %1 seconds != calculated duration of %2 seconds!")
-                        .arg(curr_progress)
-                        .arg(max_progress)
+                        .arg(curr_time)
+                        .arg(max_time)
                 );
                 _has_errors = true;
             }
-            _progress->setValue(max_progress);
+            _progress->setValue(PROGRESS_RANGE);
         }
 
         if (_close_on_end) {
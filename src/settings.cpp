@@ -46,6 +46,7 @@ static bool sync_bool(QSettings & settings, QString const& key, bool default_) {
 
 static const QString APP_USE_CHIP_RATE = QStringLiteral("app/use_chip_rate");
 static const QString APP_SAMPLE_RATE = QStringLiteral("app/sample_rate");
+static const QString APP_USE_RENDER_CACHE = QStringLiteral("app/use_render_cache");
 
 /// Read the current settings from the system. If certain settings are missing or
 /// invalid, overwrite them with defaults.
@@ -55,6 +56,7 @@ static void load_app_settings(SettingsData & data) {
     data.app = AppSettings {
         .use_chip_rate = sync_bool(persist, APP_USE_CHIP_RATE, true),
         .sample_rate = sync_u32(persist, APP_SAMPLE_RATE, 44100),
+        .use_render_cache = sync_bool(persist, APP_USE_RENDER_CACHE, true),
     };
 }
 
@@ -85,6 +87,30 @@ void Settings::set_app_settings(AppSettings app) {
     _data->app = app;
     _data->persist.setValue(APP_USE_CHIP_RATE, _data->app.use_chip_rate);
     _data->persist.setValue(APP_SAMPLE_RATE, _data->app.sample_rate);
+    _data->persist.setValue(APP_USE_RENDER_CACHE, _data->app.use_render_cache);
+}
+
+static QString core_speed_key(uint8_t type, uint32_t core, bool solo) {
+    return QStringLiteral("core_speed/%1_%2%3")
+        .arg((uint) type, 2, 16, QLatin1Char('0'))
+        .arg(core, 8, 16, QLatin1Char('0'))
+        .arg(solo ? QStringLiteral("_solo") : QString());
+}
+
+std::optional<double> Settings::core_speed(
+    uint8_t type, uint32_t core, bool solo
+) const {
+    bool ok;
+    auto val = _data->persist.value(core_speed_key(type, core, solo)).toDouble(&ok);
+    if (ok && val > 0) {
+        return val;
+    } else {
+        return {};
+    }
+}
+
+void Settings::set_core_speed(uint8_t type, uint32_t core, bool solo, double speed) {
+    _data->persist.setValue(core_speed_key(type, core, solo), speed);
 }
 
 Settings::~Settings() = default;
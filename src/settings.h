@@ -3,6 +3,7 @@
 #include "lib/copy_move.h"
 
 #include <memory>
+#include <optional>
 #include <cstdint>
 
 struct SettingsData;
@@ -14,6 +15,10 @@ struct AppSettings {
 
     /// The fallback sampling rate to use if no FM chips are present.
     uint32_t sample_rate;
+
+    /// Whether GUI renders copy channels rendered before with the same settings from
+    /// the render cache, and store newly rendered channels in it.
+    bool use_render_cache;
 };
 
 class Settings {
@@ -30,4 +35,12 @@ public:
 
     AppSettings const& app_settings() const;
     void set_app_settings(AppSettings app);
+
+    /// Returns the measured emulation speed of a sound core (in chip samples per
+    /// second of CPU time), or nullopt if it hasn't been measured yet.
+    ///
+    /// type is a DEVID_* value, and core is the core's FCC. If solo is true, returns
+    /// the speed when all but one channel is muted.
+    std::optional<double> core_speed(uint8_t type, uint32_t core, bool solo) const;
+    void set_core_speed(uint8_t type, uint32_t core, bool solo, double speed);
 };
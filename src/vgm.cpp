@@ -9,6 +9,7 @@
 #include <fmt/format.h>
 #include <fmt/compile.h>
 
+#include <algorithm>  // std::max
 #include <iterator>  // std::back_inserter
 #include <string_view>
 
@@ -313,3 +314,519 @@ std::vector<ChannelMetadata> get_chip_metadata(
     release_assert_equal(out.size(), nchannel);
     return out;
 }
+
+// Command stream scan
+
+namespace {
+
+/// State of one device, tracked by scan_vgm_activity().
+struct ChipScan {
+    ChipActivity activity;
+
+    /// Channels whose volume is currently nonzero, in the layout of
+    /// ChipActivity::active. Added to activity whenever time passes.
+    uint32_t sounding[2] = {0, 0};
+
+    /// Set if the song drives the chip in a way the scan doesn't follow.
+    bool unknown = false;
+
+    /// SN76489: the register written by data bytes. The Sega PSG starts with the
+    /// second channel's volume selected.
+    uint8_t sn_register = 3;
+
+    /// OPL family: whether rhythm mode was ever enabled.
+    bool rhythm_used = false;
+
+    /// YMF262: every 4-operator channel pair enabled at any point.
+    uint8_t four_op = 0;
+
+    void key_on(uint8_t subchip_idx, uint8_t chan_idx) {
+        activity.active[subchip_idx] |= 1u << chan_idx;
+    }
+
+    void set_sounding(uint8_t subchip_idx, uint8_t chan_idx, bool on) {
+        if (on) {
+            sounding[subchip_idx] |= 1u << chan_idx;
+        } else {
+            sounding[subchip_idx] &= ~(1u << chan_idx);
+        }
+    }
+
+    void time_passes() {
+        activity.active[0] |= sounding[0];
+        activity.active[1] |= sounding[1];
+    }
+};
+
+} // namespace
+
+/// Whether scan_vgm_activity() understands a device type. For these types, VGM DAC
+/// stream commands identify chips by their DEVID_* value.
+static bool is_scanned(uint8_t chip_type) {
+    switch (chip_type) {
+    case DEVID_SN76496:
+    case DEVID_YM2413:
+    case DEVID_YM2612:
+    case DEVID_YM2151:
+    case DEVID_YM2203:
+    case DEVID_YM2608:
+    case DEVID_YM2610:
+    case DEVID_YM3812:
+    case DEVID_YM3526:
+    case DEVID_Y8950:
+    case DEVID_YMF262:
+    case DEVID_AY8910:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// SN76489: volume registers set each channel's attenuation, where 15 is silent.
+static void scan_sn76489(ChipScan & chip, uint8_t data) {
+    // Latch bytes select a register and write its low bits, and data bytes write to
+    // the last selected register.
+    if (data & 0x80) {
+        chip.sn_register = (data >> 4) & 0x07;
+    }
+    if (chip.sn_register & 0x01) {
+        chip.set_sounding(0, chip.sn_register >> 1, (data & 0x0F) != 0x0F);
+    }
+}
+
+/// AY8910 (and the SSG in OPN chips): registers 8-10 set each channel's volume, or
+/// make it follow the envelope.
+static void scan_ssg(ChipScan & chip, uint8_t subchip_idx, uint8_t reg, uint8_t data) {
+    if (reg >= 0x08 && reg <= 0x0A) {
+        chip.set_sounding(subchip_idx, reg - 0x08, (data & 0x3F) != 0);
+    }
+}
+
+/// OPN family FM registers (port 0).
+static void scan_opn_fm(ChipScan & chip, uint8_t reg, uint8_t data, bool six_channels) {
+    if (reg == 0x27) {
+        // CSM mode keys on channel 3 whenever timer A overflows.
+        if ((data & 0xC0) == 0x80) {
+            chip.key_on(0, 2);
+        }
+    } else if (reg == 0x28 && (data & 0xF0)) {
+        uint8_t chan_idx = data & 0x03;
+        if (chan_idx == 3) {
+            return;
+        }
+        if (six_channels && (data & 0x04)) {
+            chan_idx += 3;
+        }
+        chip.key_on(0, chan_idx);
+    }
+}
+
+/// OPL family rhythm register (0xBD, or 0x0E on YM2413). Bit 5 enables rhythm
+/// mode, and bits 4-0 key on the bass drum, snare drum, tom tom, cymbal and hi-hat.
+/// These are channels drum_begin to drum_begin + 4.
+static void scan_opl_rhythm(ChipScan & chip, uint8_t data, uint8_t drum_begin) {
+    // Turning off rhythm mode keys off all drums.
+    if (!(data & 0x20)) {
+        return;
+    }
+    chip.rhythm_used = true;
+    for (uint8_t drum = 0; drum < 5; drum++) {
+        if (data & (0x10 >> drum)) {
+            chip.key_on(0, drum_begin + drum);
+        }
+    }
+}
+
+/// In rhythm mode, drums play from the operators of channels 7-9, so notes keyed on
+/// those channels can sound as drums. Call once the song has been scanned.
+static void finish_opl_rhythm(ChipScan & chip, uint8_t drum_begin) {
+    // Drums played by channels 7, 8 and 9, as bits of drum indices.
+    constexpr uint8_t CHANNEL_DRUMS[3] = {
+        0x01,  // bass drum
+        0x12,  // snare drum, hi-hat
+        0x0C,  // tom tom, cymbal
+    };
+
+    if (!chip.rhythm_used) {
+        return;
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        if (!(chip.activity.active[0] & (1u << (6 + i)))) {
+            continue;
+        }
+        for (uint8_t drum = 0; drum < 5; drum++) {
+            if (CHANNEL_DRUMS[i] & (1u << drum)) {
+                chip.key_on(0, drum_begin + drum);
+            }
+        }
+    }
+}
+
+/// YMF262: a 4-operator channel pair sounds through both channels' mute bits, so
+/// if either channel is active, treat both as active.
+static void finish_opl3_four_op(ChipScan & chip) {
+    for (uint8_t pair = 0; pair < 6; pair++) {
+        if (!(chip.four_op & (1u << pair))) {
+            continue;
+        }
+        uint8_t first = pair < 3 ? pair : 9 + (pair - 3);
+        uint32_t mask = (1u << first) | (1u << (first + 3));
+        if (chip.activity.active[0] & mask) {
+            chip.activity.active[0] |= mask;
+        }
+    }
+}
+
+static void scan_write(
+    ChipScan & chip, uint8_t chip_type, uint8_t port, uint8_t reg, uint8_t data
+) {
+    switch (chip_type) {
+    case DEVID_YM2413:
+        if (reg == 0x0E) {
+            scan_opl_rhythm(chip, data, 9);
+        } else if (reg >= 0x20 && reg <= 0x28 && (data & 0x10)) {
+            chip.key_on(0, reg - 0x20);
+        }
+        break;
+
+    case DEVID_YM2612:
+        if (port != 0) {
+            break;
+        }
+        scan_opn_fm(chip, reg, data, true);
+        if (reg == 0x2B && (data & 0x80)) {
+            chip.key_on(0, 6);
+        } else if (reg == 0x2C && (data & 0x20)) {
+            // DAC test mode plays the DAC on every channel.
+            for (uint8_t chan_idx = 0; chan_idx < 7; chan_idx++) {
+                chip.key_on(0, chan_idx);
+            }
+        }
+        break;
+
+    case DEVID_YM2151:
+        if (reg == 0x08 && (data & 0x78)) {
+            chip.key_on(0, data & 0x07);
+        } else if (reg == 0x14 && (data & 0x80)) {
+            // CSM mode keys on every channel whenever timer A overflows.
+            chip.activity.active[0] |= 0xFF;
+        }
+        break;
+
+    case DEVID_YM2203:
+        if (reg < 0x10) {
+            scan_ssg(chip, 1, reg, data);
+        } else {
+            scan_opn_fm(chip, reg, data, false);
+        }
+        break;
+
+    case DEVID_YM2608:
+        if (port == 0) {
+            if (reg < 0x10) {
+                scan_ssg(chip, 1, reg, data);
+            } else if (reg == 0x10) {
+                // Rhythm key on (unless bit 7 is set, which keys off instead).
+                if (!(data & 0x80)) {
+                    chip.activity.active[0] |= (uint32_t) (data & 0x3F) << 6;
+                }
+            } else {
+                scan_opn_fm(chip, reg, data, true);
+            }
+        } else if (reg == 0x00 && (data & 0x80)) {
+            // ADPCM start
+            chip.key_on(0, 12);
+        }
+        break;
+
+    case DEVID_YM2610:
+        if (port == 0) {
+            if (reg < 0x10) {
+                scan_ssg(chip, 1, reg, data);
+            } else if (reg == 0x10) {
+                // ADPCM-B start
+                if (data & 0x80) {
+                    chip.key_on(0, 12);
+                }
+            } else {
+                scan_opn_fm(chip, reg, data, true);
+            }
+        } else if (reg == 0x00 && !(data & 0x80)) {
+            // ADPCM-A key on
+            chip.activity.active[0] |= (uint32_t) (data & 0x3F) << 6;
+        }
+        break;
+
+    case DEVID_YM3812:
+    case DEVID_YM3526:
+    case DEVID_Y8950:
+        if (reg >= 0xB0 && reg <= 0xB8 && (data & 0x20)) {
+            chip.key_on(0, reg - 0xB0);
+        } else if (reg == 0xBD) {
+            scan_opl_rhythm(chip, data, 9);
+        } else if (reg == 0x08 && (data & 0x80)) {
+            // CSM mode keys on every melodic channel whenever timer A overflows.
+            chip.activity.active[0] |= 0x1FF;
+        } else if (chip_type == DEVID_Y8950 && reg == 0x07 && (data & 0x80)) {
+            // ADPCM start
+            chip.key_on(0, 14);
+        }
+        break;
+
+    case DEVID_YMF262:
+        if (reg >= 0xB0 && reg <= 0xB8 && (data & 0x20)) {
+            chip.key_on(0, (uint8_t) (9 * port + reg - 0xB0));
+        } else if (port == 0 && reg == 0xBD) {
+            scan_opl_rhythm(chip, data, 18);
+        } else if (port == 1 && reg == 0x04) {
+            chip.four_op |= data & 0x3F;
+        }
+        break;
+
+    case DEVID_AY8910:
+        scan_ssg(chip, 0, reg, data);
+        break;
+    }
+}
+
+/// The device and port written by VGM commands 0x51-0x5F (and 0xA1-0xAF for the
+/// second chip), indexed by the command's low 4 bits. 0xFF if not scanned.
+struct CommandTarget {
+    uint8_t chip_type;
+    uint8_t port;
+};
+static constexpr CommandTarget REG_COMMANDS[0x10] = {
+    {0xFF, 0},  // 0x50 is SN76489, and 0xA0 is AY8910.
+    {DEVID_YM2413, 0},
+    {DEVID_YM2612, 0},
+    {DEVID_YM2612, 1},
+    {DEVID_YM2151, 0},
+    {DEVID_YM2203, 0},
+    {DEVID_YM2608, 0},
+    {DEVID_YM2608, 1},
+    {DEVID_YM2610, 0},
+    {DEVID_YM2610, 1},
+    {DEVID_YM3812, 0},
+    {DEVID_YM3526, 0},
+    {DEVID_Y8950, 0},
+    {0xFF, 0},  // YMZ280B
+    {DEVID_YMF262, 0},
+    {DEVID_YMF262, 1},
+};
+
+/// Returns the length of the VGM command at data[0], or 0 if the command is invalid
+/// (which ends playback) or runs past the end of the data.
+static size_t command_length(uint8_t const* data, size_t size) {
+    uint8_t const cmd = data[0];
+    size_t len;
+
+    if (cmd >= 0x30 && cmd <= 0x3F) {
+        len = 2;
+    } else if (cmd >= 0x40 && cmd <= 0x4E) {
+        len = 3;
+    } else if (cmd == 0x4F || cmd == 0x50) {
+        len = 2;
+    } else if ((cmd >= 0x51 && cmd <= 0x5F) || cmd == 0x61) {
+        len = 3;
+    } else if (cmd == 0x00 || cmd == 0x62 || cmd == 0x63 || cmd == 0x66) {
+        len = 1;
+    } else if (cmd == 0x67) {
+        // Data block: 0x67 0x66 type size32 data...
+        if (size < 7) {
+            return 0;
+        }
+        uint32_t block_size = (uint32_t) data[3] | (uint32_t) data[4] << 8
+            | (uint32_t) data[5] << 16 | (uint32_t) (data[6] & 0x7F) << 24;
+        len = 7 + (size_t) block_size;
+    } else if (cmd == 0x68) {
+        len = 12;
+    } else if (cmd >= 0x70 && cmd <= 0x8F) {
+        len = 1;
+    } else if (cmd == 0x90 || cmd == 0x91 || cmd == 0x95) {
+        len = 5;
+    } else if (cmd == 0x92) {
+        len = 6;
+    } else if (cmd == 0x93) {
+        len = 11;
+    } else if (cmd == 0x94) {
+        len = 2;
+    } else if (cmd >= 0xA0 && cmd <= 0xBF) {
+        len = 3;
+    } else if (cmd >= 0xC0 && cmd <= 0xDF) {
+        len = 4;
+    } else if (cmd >= 0xE0) {
+        len = 5;
+    } else {
+        return 0;
+    }
+
+    return len <= size ? len : 0;
+}
+
+static uint32_t read_le32(uint8_t const* data) {
+    return (uint32_t) data[0] | (uint32_t) data[1] << 8
+        | (uint32_t) data[2] << 16 | (uint32_t) data[3] << 24;
+}
+
+/// Returns the offset of a .vgm file's first command, or 0 if data isn't a .vgm file.
+static size_t first_command(uint8_t const* data, size_t size) {
+    if (size < 0x40 || std::string_view((char const*) data, 4) != "Vgm ") {
+        return 0;
+    }
+    uint32_t const version = read_le32(data + 0x08);
+    size_t pos = 0x40;
+    if (version >= 0x150 && read_le32(data + 0x34) != 0) {
+        pos = std::max((size_t) 0x38, 0x34 + (size_t) read_le32(data + 0x34));
+    }
+    return pos;
+}
+
+uint64_t vgm_data_block_bytes(uint8_t const* data, size_t size) {
+    size_t pos = first_command(data, size);
+    if (pos == 0) {
+        return 0;
+    }
+
+    uint64_t bytes = 0;
+    // ROM dumps are written into a ROM allocated once per chip (and block type),
+    // at the total ROM size stored in each dump's header.
+    std::map<uint16_t, uint32_t> rom_sizes;
+
+    while (pos < size) {
+        uint8_t const* cmd = data + pos;
+        size_t const len = command_length(cmd, size - pos);
+        if (len == 0 || cmd[0] == 0x66) {
+            break;
+        }
+        pos += len;
+        if (cmd[0] != 0x67) {
+            continue;
+        }
+
+        // Data block: 0x67 0x66 type size32 data...
+        uint8_t const type = cmd[2];
+        uint32_t const block_size = (uint32_t) (len - 7);
+        uint8_t const* block = cmd + 7;
+        if (type < 0x40 || type == 0x7F) {
+            // PCM data and decompression tables are copied into the player.
+            bytes += block_size;
+        } else if (type < 0x7F) {
+            // Compressed PCM data is decompressed into the player:
+            // compression type, uncompressed size32, ...
+            bytes += block_size >= 5 ? read_le32(block + 1) : block_size;
+        } else if (type < 0xC0 && block_size >= 8) {
+            // ROM dump: total ROM size32, start address32, data... The size's top bit
+            // selects the second chip.
+            auto const key = (uint16_t) (type << 1 | (cmd[6] >> 7));
+            uint32_t & rom_size = rom_sizes[key];
+            rom_size = std::max(rom_size, read_le32(block));
+        }
+        // RAM writes (0xC0 and up) write into memory the chip always allocates.
+    }
+
+    for (auto const& [key, rom_size] : rom_sizes) {
+        bytes += rom_size;
+    }
+    return bytes;
+}
+
+std::map<uint32_t, ChipActivity> scan_vgm_activity(
+    uint8_t const* data, size_t size, std::vector<PLR_DEV_INFO> const& devices
+) {
+    std::map<uint32_t, ChipActivity> out;
+
+    size_t pos = first_command(data, size);
+    if (pos == 0) {
+        return out;
+    }
+
+    // A T6W28 is emulated as two SN76489 chips sharing registers, which this scan
+    // doesn't model.
+    bool const t6w28 = read_le32(data + 0x0C) & 0x80000000;
+
+    std::map<uint32_t, ChipScan> chips;
+    for (PLR_DEV_INFO const& device : devices) {
+        if (!is_scanned(device.type) || (device.type == DEVID_SN76496 && t6w28)) {
+            continue;
+        }
+        chips[PLR_DEV_ID((uint32_t) device.type, (uint32_t) device.instance)] = {};
+    }
+
+    auto const find_chip = [&chips](uint8_t chip_type, uint8_t instance) -> ChipScan * {
+        auto it = chips.find(PLR_DEV_ID((uint32_t) chip_type, (uint32_t) instance));
+        return it != chips.end() ? &it->second : nullptr;
+    };
+    auto const time_passes = [&chips]() {
+        for (auto & [chip_id, chip] : chips) {
+            chip.time_passes();
+        }
+    };
+
+    while (pos < size) {
+        uint8_t const* cmd = data + pos;
+        size_t const len = command_length(cmd, size - pos);
+        if (len == 0 || cmd[0] == 0x66) {
+            break;
+        }
+        pos += len;
+
+        if (cmd[0] == 0x50 || cmd[0] == 0x30) {
+            if (ChipScan * chip = find_chip(DEVID_SN76496, cmd[0] == 0x30)) {
+                scan_sn76489(*chip, cmd[1]);
+            }
+        } else if (cmd[0] == 0xA0) {
+            if (ChipScan * chip = find_chip(DEVID_AY8910, cmd[1] >> 7)) {
+                scan_ssg(*chip, 0, cmd[1] & 0x7F, cmd[2]);
+            }
+        } else if (
+            (cmd[0] >= 0x51 && cmd[0] <= 0x5F) || (cmd[0] >= 0xA1 && cmd[0] <= 0xAF)
+        ) {
+            CommandTarget const& target = REG_COMMANDS[cmd[0] & 0x0F];
+            if (target.chip_type == 0xFF) {
+                continue;
+            }
+            if (ChipScan * chip = find_chip(target.chip_type, cmd[0] >= 0xA0)) {
+                scan_write(*chip, target.chip_type, target.port, cmd[1], cmd[2]);
+            }
+        } else if (cmd[0] == 0x90) {
+            // DAC stream setup: 0x90 stream chip port reg. Streams are only followed
+            // when they write YM2612 DAC samples (which are only heard once the DAC
+            // is enabled).
+            uint8_t const chip_type = cmd[2] & 0x7F;
+            if (chip_type == DEVID_YM2612 && cmd[3] == 0x00 && cmd[4] == 0x2A) {
+                continue;
+            }
+            if (ChipScan * chip = find_chip(chip_type, cmd[2] >> 7)) {
+                chip->unknown = true;
+            }
+        } else if (
+            cmd[0] == 0x61 || cmd[0] == 0x62 || cmd[0] == 0x63
+            || (cmd[0] >= 0x70 && cmd[0] <= 0x8F)
+        ) {
+            time_passes();
+        }
+    }
+    // When the song loops, channels left sounding at the end keep sounding.
+    time_passes();
+
+    for (auto & [chip_id, chip] : chips) {
+        if (chip.unknown) {
+            continue;
+        }
+        auto const chip_type = (uint8_t) (chip_id & 0xFF);
+        switch (chip_type) {
+        case DEVID_YM2413:
+        case DEVID_YM3812:
+        case DEVID_YM3526:
+        case DEVID_Y8950:
+            finish_opl_rhythm(chip, 9);
+            break;
+        case DEVID_YMF262:
+            finish_opl3_four_op(chip);
+            finish_opl_rhythm(chip, 18);
+            break;
+        }
+        out.emplace(chip_id, chip.activity);
+    }
+    return out;
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -25,3 +27,22 @@ struct ChannelMetadata {
 std::vector<ChannelMetadata> get_chip_metadata(
     PLR_DEV_INFO const& device, bool show_chip_name
 );
+
+/// Which channels of one chip a song uses, in the layout of PLR_MUTE_OPTS::chnMute
+/// (bit chan_idx of active[subchip_idx] is set if the channel is used).
+struct ChipActivity {
+    uint32_t active[2] = {0, 0};
+};
+
+/// Scans a .vgm file's commands (without emulating any chips) for channels which
+/// are keyed on or given a nonzero volume. Returns the activity of each device
+/// (keyed by PLR_DEV_ID(type, instance)) whose channels could be determined.
+/// Devices which the scan doesn't understand, or which the song drives in ways the
+/// scan can't follow, are left out.
+std::map<uint32_t, ChipActivity> scan_vgm_activity(
+    uint8_t const* data, size_t size, std::vector<PLR_DEV_INFO> const& devices
+);
+
+/// Estimates the bytes a VGM player allocates to hold a .vgm file's data blocks
+/// (PCM banks and chip ROMs), once per player. Returns 0 if data isn't a .vgm file.
+uint64_t vgm_data_block_bytes(uint8_t const* data, size_t size);
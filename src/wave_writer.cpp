@@ -4,6 +4,17 @@
 #include "wave_writer.h"
 #include "lib/defer.h"
 
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <utility>
 
 /* Copyright (C) 2003-2008 Shay Green. This module is free software; you
@@ -17,7 +28,20 @@ details. You should have received a copy of the GNU Lesser General Public
 License along with this module; if not, write to the Free Software Foundation,
 Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA */
 
-static constexpr uint32_t BYTES_PER_SAMPLE = sizeof(Wave_Writer::Amplitude);
+static constexpr int64_t RIFF_HEADER_SIZE = 0x2C;
+/// RF64 adds a ds64 chunk holding 64-bit sizes.
+static constexpr int64_t RF64_HEADER_SIZE = RIFF_HEADER_SIZE + 0x24;
+
+/// The largest amount of sample data which fits in a RIFF file's 32-bit size fields.
+static constexpr uint64_t RIFF_MAX_DATA_SIZE = 0xFFFFFFFFu - (RIFF_HEADER_SIZE - 8);
+
+/// In async mode, each Wave_Writer sends data to the background thread in chunks of
+/// this size.
+static constexpr int ASYNC_CHUNK_SIZE = 2 << 20;
+
+/// If the disk can't keep up with rendering, Wave_Writer::write() blocks once this
+/// much data is queued, rather than buffering an unbounded amount of audio in RAM.
+static constexpr int64_t MAX_QUEUED_BYTES = 64 << 20;
 
 using stx::Ok, stx::Err;
 using std::move;
@@ -38,10 +62,81 @@ static void set_le32( unsigned char p [4], unsigned n )
     p [3] = (unsigned char) (n >> 24);
 }
 
+static void set_le64( unsigned char p [8], uint64_t n )
+{
+    set_le32( p,     (unsigned) (n      ) );
+    set_le32( p + 4, (unsigned) (n >> 32) );
+}
+
+static uint32_t bytes_per_sample(Wave_Writer const& self)
+{
+    return sample_size(self._format);
+}
+
+/// WAVE_FORMAT_PCM or WAVE_FORMAT_IEEE_FLOAT.
+static uint8_t format_tag(Wave_Writer const& self)
+{
+    return self._format == SampleFormat::Float32 ? 3 : 1;
+}
+
+static int64_t header_size(Wave_Writer const& self)
+{
+    return self._rf64 ? RF64_HEADER_SIZE : RIFF_HEADER_SIZE;
+}
+
+/// Writes an RF64 header (EBU Tech 3306), where the 32-bit RIFF sizes are set to -1
+/// and the real sizes are stored in a ds64 chunk.
+[[nodiscard]] static QString write_rf64_header(Wave_Writer & self)
+{
+    static_assert(RF64_HEADER_SIZE == 0x50);
+    uint64_t data_size  = bytes_per_sample(self) * self._sample_count;
+    auto frame_size = (uint8_t) (bytes_per_sample(self) * self._chan_count);
+    unsigned char h [0x50] =
+    {
+        'R','F','6','4',
+        0xFF,0xFF,0xFF,0xFF,/* length of rest of file (in ds64) */
+        'W','A','V','E',
+        'd','s','6','4',
+        28,0,0,0,       /* size of ds64 chunk */
+        0,0,0,0,0,0,0,0,/* length of rest of file */
+        0,0,0,0,0,0,0,0,/* size of sample data */
+        0,0,0,0,0,0,0,0,/* sample frame count */
+        0,0,0,0,        /* table length */
+        'f','m','t',' ',
+        16,0,0,0,       /* size of fmt chunk */
+        0,0,            /* sample format */
+        0,0,            /* channel count */
+        0,0,0,0,        /* sample rate */
+        0,0,0,0,        /* bytes per second */
+        0,0,            /* bytes per sample frame */
+        0,0,            /* bits per sample */
+        'd','a','t','a',
+        0xFF,0xFF,0xFF,0xFF /* size of sample data (in ds64) */
+        /* ... */       /* sample data */
+    };
+
+    set_le64( h + 0x14, sizeof h - 8 + data_size );
+    set_le64( h + 0x1C, data_size );
+    set_le64( h + 0x24, self._sample_count / self._chan_count );
+    h [0x38] = format_tag(self);
+    h [0x3A] = self._chan_count;
+    set_le32( h + 0x3C, self._sample_rate );
+    set_le32( h + 0x40, self._sample_rate * frame_size );
+    h [0x44] = frame_size;
+    h [0x46] = (unsigned char) (bytes_per_sample(self) * 8);
+
+    return write_data(self._file, h, sizeof h);
+}
+
 [[nodiscard]] static QString write_header(Wave_Writer & self)
 {
-    uint32_t data_size  = BYTES_PER_SAMPLE * self._sample_count;
-    uint8_t frame_size = BYTES_PER_SAMPLE * self._chan_count;
+    if (self._rf64) {
+        return write_rf64_header(self);
+    }
+
+    static_assert(RIFF_HEADER_SIZE == 0x2C);
+    uint32_t data_size  = (uint32_t) (bytes_per_sample(self) * self._sample_count);
+    auto frame_size = (uint8_t) (bytes_per_sample(self) * self._chan_count);
     unsigned char h [0x2C] =
     {
         'R','I','F','F',
@@ -49,39 +144,139 @@ static void set_le32( unsigned char p [4], unsigned n )
         'W','A','V','E',
         'f','m','t',' ',
         16,0,0,0,       /* size of fmt chunk */
-        1,0,            /* uncompressed format */
+        0,0,            /* sample format */
         0,0,            /* channel count */
         0,0,0,0,        /* sample rate */
         0,0,0,0,        /* bytes per second */
         0,0,            /* bytes per sample frame */
-        BYTES_PER_SAMPLE * 8,0,/* bits per sample */
+        0,0,            /* bits per sample */
         'd','a','t','a',
         0,0,0,0         /* size of sample data */
         /* ... */       /* sample data */
     };
 
-    set_le32( h + 0x04, sizeof h - 8 + data_size );
+    set_le32( h + 0x04, (unsigned) (sizeof h - 8 + data_size) );
+    h [0x14] = format_tag(self);
     h [0x16] = self._chan_count;
     set_le32( h + 0x18, self._sample_rate );
     set_le32( h + 0x1C, self._sample_rate * frame_size );
     h [0x20] = frame_size;
+    h [0x22] = (unsigned char) (bytes_per_sample(self) * 8);
     set_le32( h + 0x28, data_size );
 
     return write_data(self._file, h, sizeof h);
 }
 
-Wave_Writer::Wave_Writer(uint32_t sample_rate, QString const& path)
+/// Writes chunks of audio queued by async Wave_Writer. Writing files on a separate
+/// thread lets render threads keep emulating while the disk is busy.
+class WriteThread {
+    struct Task {
+        Wave_Writer * writer;
+        QByteArray data;
+    };
+
+    std::mutex _mutex;
+    /// Notified when a task is queued or completes, or when the thread should quit.
+    std::condition_variable _cv;
+    std::deque<Task> _tasks;
+    int64_t _queued_bytes = 0;
+    bool _quit = false;
+
+    std::thread _thread;
+
+public:
+    WriteThread()
+        : _thread([this] { run(); })
+    {}
+
+    ~WriteThread() {
+        {
+            auto lock = std::lock_guard(_mutex);
+            _quit = true;
+        }
+        _cv.notify_all();
+        _thread.join();
+    }
+
+    DISABLE_COPY_MOVE(WriteThread)
+
+    static WriteThread & instance() {
+        static WriteThread thread;
+        return thread;
+    }
+
+    void push(Wave_Writer & writer, QByteArray data) {
+        auto lock = std::unique_lock(_mutex);
+        _cv.wait(lock, [this] { return _queued_bytes < MAX_QUEUED_BYTES; });
+
+        _queued_bytes += data.size();
+        writer._inflight++;
+        _tasks.push_back(Task{&writer, move(data)});
+
+        lock.unlock();
+        _cv.notify_all();
+    }
+
+    /// Returns the first error writing data for this writer, if any.
+    QString error(Wave_Writer & writer) {
+        auto lock = std::lock_guard(_mutex);
+        return writer._async_error;
+    }
+
+    /// Waits until all data queued for this writer has been written. Returns the
+    /// first error writing data, if any.
+    QString wait(Wave_Writer & writer) {
+        auto lock = std::unique_lock(_mutex);
+        _cv.wait(lock, [&writer] { return writer._inflight == 0; });
+        return writer._async_error;
+    }
+
+private:
+    void run() {
+        auto lock = std::unique_lock(_mutex);
+        while (true) {
+            _cv.wait(lock, [this] { return _quit || !_tasks.empty(); });
+            if (_tasks.empty()) {
+                return;
+            }
+            Task task = move(_tasks.front());
+            _tasks.pop_front();
+
+            // Each Wave_Writer's _file is only accessed by this thread while it has
+            // queued chunks, and chunks are written in order.
+            lock.unlock();
+            auto err = write_data(task.writer->_file, task.data.data(), task.data.size());
+            lock.lock();
+
+            if (!err.isEmpty() && task.writer->_async_error.isEmpty()) {
+                task.writer->_async_error = move(err);
+            }
+            _queued_bytes -= task.data.size();
+            task.writer->_inflight--;
+            _cv.notify_all();
+        }
+    }
+};
+
+Wave_Writer::Wave_Writer(uint32_t sample_rate, SampleFormat format, QString const& path)
     : _file(path)
     , _sample_count(0)
     , _sample_rate(sample_rate)
     , _chan_count(1)
+    , _format(format)
 {}
 
 Result<std::unique_ptr<Wave_Writer>, QString> Wave_Writer::make(
-    uint32_t sample_rate, QString const& path
+    uint32_t sample_rate,
+    SampleFormat format,
+    QString const& path,
+    uint64_t expected_nsamp
 ) {
-    auto out = std::make_unique<Wave_Writer>(sample_rate, path);
-    if (!out->_file.open(QFile::WriteOnly)) {
+    auto out = std::make_unique<Wave_Writer>(sample_rate, format, path);
+    // RF64 is less widely supported than RIFF, so only use it when necessary.
+    out->_rf64 = expected_nsamp * bytes_per_sample(*out) > RIFF_MAX_DATA_SIZE;
+    // copy_samples() reads back written samples.
+    if (!out->_file.open(QFile::ReadWrite | QFile::Truncate)) {
         return Err(out->_file.errorString());
     }
     // Write a header with dummy information. The real length/channel fields
@@ -92,10 +287,84 @@ Result<std::unique_ptr<Wave_Writer>, QString> Wave_Writer::make(
     return Ok(move(out));
 }
 
+Result<std::unique_ptr<Wave_Writer>, QString> Wave_Writer::make_segment(
+    uint32_t sample_rate, SampleFormat format, QString const& path,
+    uint64_t expected_nsamp, uint64_t offset
+) {
+    auto out = std::make_unique<Wave_Writer>(sample_rate, format, path);
+    out->_rf64 = expected_nsamp * bytes_per_sample(*out) > RIFF_MAX_DATA_SIZE;
+    out->_segment_offset = offset;
+
+    // Other segments may be writing to the same file, so don't truncate it.
+    if (!out->_file.open(QFile::ReadWrite)) {
+        return Err(out->_file.errorString());
+    }
+    if (
+        !out->_file.seek(header_size(*out) + (int64_t) (offset * bytes_per_sample(*out)))
+    ) {
+        return Err(out->_file.errorString());
+    }
+    return Ok(move(out));
+}
+
+QString Wave_Writer::finish_segments(
+    uint32_t sample_rate, SampleFormat format, QString const& path,
+    uint64_t expected_nsamp, uint64_t nsamp
+) {
+    Wave_Writer w(sample_rate, format, path);
+    w._rf64 = expected_nsamp * bytes_per_sample(w) > RIFF_MAX_DATA_SIZE;
+    w._chan_count = 2;
+    w._sample_count = nsamp;
+
+    if (!w._rf64 && nsamp * bytes_per_sample(w) > RIFF_MAX_DATA_SIZE) {
+        return QStringLiteral("File exceeds 4 GiB .wav size limit");
+    }
+    if (!w._file.open(QFile::ReadWrite)) {
+        return w._file.errorString();
+    }
+    if (!w._file.resize(header_size(w) + (int64_t) (nsamp * bytes_per_sample(w)))) {
+        return w._file.errorString();
+    }
+    // close() writes the header.
+    return w.close();
+}
+
 QString Wave_Writer::close()
 {
     // May be called multiple times. Must be idempotent.
     if (_file.isOpen()) {
+        if (_async) {
+            if (!_chunk.isEmpty()) {
+                WriteThread::instance().push(*this, move(_chunk));
+                _chunk = QByteArray();
+            }
+            if (auto err = WriteThread::instance().wait(*this); !err.isEmpty()) {
+                _file.close();
+                return err;
+            }
+        }
+
+        // Other segments may still be writing to the file, and finish_segments()
+        // writes the header.
+        if (_segment_offset) {
+            if (!_file.flush()) {
+                return _file.errorString();
+            }
+            _file.close();
+            return {};
+        }
+
+        // If the render stopped early, remove the unused preallocated space.
+        if (_preallocated) {
+            auto size =
+                header_size(*this) + (int64_t) (_sample_count * bytes_per_sample(*this));
+            if (!_file.resize(size)) {
+                auto err = _file.errorString();
+                _file.close();
+                return err;
+            }
+        }
+
         _file.seek(0);
         if (auto err = write_header(*this); !err.isEmpty()) {
             _file.close();
@@ -116,14 +385,59 @@ void Wave_Writer::enable_stereo()
     _chan_count = 2;
 }
 
-[[nodiscard]] QString Wave_Writer::write(Amplitude const* in, uint32_t nsamp)
+void Wave_Writer::enable_async()
+{
+    _async = true;
+    _chunk.reserve(ASYNC_CHUNK_SIZE);
+}
+
+QString Wave_Writer::preallocate(uint64_t nsamp)
+{
+    // Extending the file doesn't move the write position, which remains after the
+    // header.
+    auto size = header_size(*this) + (int64_t) (nsamp * bytes_per_sample(*this));
+#ifdef Q_OS_LINUX
+    // Allocate real disk blocks rather than a sparse file. If the filesystem doesn't
+    // support it, fall back to resize().
+    if (posix_fallocate(_file.handle(), 0, size) == 0) {
+        _preallocated = true;
+        return {};
+    }
+#endif
+    if (!_file.resize(size)) {
+        return _file.errorString();
+    }
+    _preallocated = true;
+    return {};
+}
+
+[[nodiscard]] QString Wave_Writer::write(void const* in, uint32_t nsamp)
 {
+    // Fail rather than writing a corrupted header, if make() was given too short
+    // a length.
+    uint64_t end = _segment_offset.value_or(0) + _sample_count + nsamp;
+    if (!_rf64 && end * bytes_per_sample(*this) > RIFF_MAX_DATA_SIZE) {
+        return QStringLiteral("File exceeds 4 GiB .wav size limit");
+    }
     _sample_count += nsamp;
 
     // This only works properly on little-endian CPUs, but is faster than chunking the
     // input to convert to little endian.
+    if (_async) {
+        _chunk.append((char const*) in, (int) (nsamp * bytes_per_sample(*this)));
+        if (_chunk.size() >= ASYNC_CHUNK_SIZE) {
+            if (auto err = WriteThread::instance().error(*this); !err.isEmpty()) {
+                return err;
+            }
+            WriteThread::instance().push(*this, move(_chunk));
+            _chunk = QByteArray();
+            _chunk.reserve(ASYNC_CHUNK_SIZE);
+        }
+        return {};
+    }
+
     if (
-        auto err = write_data(_file, in, (int64_t) nsamp * BYTES_PER_SAMPLE);
+        auto err = write_data(_file, in, (int64_t) nsamp * bytes_per_sample(*this));
         !err.isEmpty()
     ) {
         return err;
@@ -131,7 +445,82 @@ void Wave_Writer::enable_stereo()
     return {};
 }
 
-uint32_t Wave_Writer::sample_count() const
+QString Wave_Writer::copy_samples(uint64_t begin, uint64_t nsamp)
+{
+    assert(begin + nsamp <= _sample_count);
+    uint64_t end = _segment_offset.value_or(0) + _sample_count + nsamp;
+    if (!_rf64 && end * bytes_per_sample(*this) > RIFF_MAX_DATA_SIZE) {
+        return QStringLiteral("File exceeds 4 GiB .wav size limit");
+    }
+
+    // The samples being copied must be in the file first.
+    if (_async) {
+        if (!_chunk.isEmpty()) {
+            WriteThread::instance().push(*this, move(_chunk));
+            _chunk = QByteArray();
+            _chunk.reserve(ASYNC_CHUNK_SIZE);
+        }
+        if (auto err = WriteThread::instance().wait(*this); !err.isEmpty()) {
+            return err;
+        }
+    }
+    if (!_file.flush()) {
+        return _file.errorString();
+    }
+
+    uint32_t const sample_bytes = bytes_per_sample(*this);
+    auto data_start =
+        header_size(*this) + (int64_t) (_segment_offset.value_or(0) * sample_bytes);
+    auto src = data_start + (int64_t) (begin * sample_bytes);
+    auto dst = data_start + (int64_t) (_sample_count * sample_bytes);
+    auto remaining = (int64_t) (nsamp * sample_bytes);
+
+#ifdef Q_OS_LINUX
+    while (remaining > 0) {
+        off64_t in = src;
+        off64_t out = dst;
+        ssize_t n = copy_file_range(
+            _file.handle(), &in, _file.handle(), &out, (size_t) remaining, 0);
+        // If the kernel or filesystem doesn't support copying, fall back to reading
+        // and writing the data.
+        if (n <= 0) {
+            break;
+        }
+        src += n;
+        dst += n;
+        remaining -= n;
+    }
+#endif
+
+    while (remaining > 0) {
+        auto size = std::min(remaining, (int64_t) ASYNC_CHUNK_SIZE);
+        if (!_file.seek(src)) {
+            return _file.errorString();
+        }
+        QByteArray data = _file.read(size);
+        if (data.size() != size) {
+            return _file.errorString();
+        }
+        if (!_file.seek(dst)) {
+            return _file.errorString();
+        }
+        if (auto err = write_data(_file, data.data(), size); !err.isEmpty()) {
+            return err;
+        }
+        src += size;
+        dst += size;
+        remaining -= size;
+    }
+
+    // Later writes go after the copy.
+    if (!_file.seek(dst)) {
+        return _file.errorString();
+    }
+    _sample_count += nsamp;
+    return {};
+}
+
+uint64_t Wave_Writer::sample_count() const
 {
     return _sample_count;
 }
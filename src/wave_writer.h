@@ -8,10 +8,12 @@
 
 #include <stx/result.h>
 
+#include <QByteArray>
 #include <QFile>
 
 #include <cstdint>
 #include <memory>
+#include <optional>
 
 #ifndef wave_writer_INTERNAL
 #define wave_writer_INTERNAL private
@@ -19,36 +21,116 @@
 
 using stx::Result;
 
+/// Format of each sample in a .wav file.
+enum class SampleFormat : uint8_t {
+    /// 16-bit integer PCM.
+    Int16,
+    /// 24-bit integer PCM.
+    Int24,
+    /// 32-bit IEEE float PCM. Full scale is +-1.0, and louder samples aren't clipped.
+    Float32,
+};
+
+/// Size of each sample in bytes.
+constexpr uint32_t sample_size(SampleFormat format) {
+    switch (format) {
+    case SampleFormat::Int16: return 2;
+    case SampleFormat::Int24: return 3;
+    case SampleFormat::Float32: return 4;
+    }
+    return 2;
+}
+
+/// The largest sample_size() of any format.
+constexpr uint32_t MAX_SAMPLE_SIZE = 4;
+
 /* C++ interface */
 class Wave_Writer {
 wave_writer_INTERNAL:
     QFile _file;
-    uint32_t   _sample_count;
+    uint64_t   _sample_count;
     uint32_t   _sample_rate;
     uint8_t   _chan_count;
+    SampleFormat _format;
 
-public:
-    using Amplitude = int16_t;
+    /// If true, the file has an RF64 header with 64-bit sizes.
+    bool _rf64 = false;
+
+    /// If set, this writer fills part of a file written by multiple writers, starting
+    /// at this many samples past the start of the sample data. close() does not
+    /// write a header.
+    std::optional<uint64_t> _segment_offset;
+
+    /// Whether the file was extended by preallocate().
+    bool _preallocated = false;
+
+    /// If true, write() queues data to be written on a background thread.
+    bool _async = false;
+    /// In async mode, collects written data until it's large enough to queue.
+    QByteArray _chunk;
+
+    /// Accessed by the background thread, guarded by its mutex.
+    /// Number of queued chunks which haven't been written yet.
+    uint32_t _inflight = 0;
+    /// The first error encountered by the background thread.
+    QString _async_error;
 
 wave_writer_INTERNAL:
-    Wave_Writer(uint32_t sample_rate, QString const& path);
+    Wave_Writer(uint32_t sample_rate, SampleFormat format, QString const& path);
     DISABLE_COPY_MOVE(Wave_Writer)
 
 public:
     /// Creates and opens sound file of given sample rate and filename.
+    /// If expected_nsamp samples would exceed the 4 GiB limit of .wav files,
+    /// writes an RF64 file instead.
     /// If opening file or writing header fails, returns Err.
     static Result<std::unique_ptr<Wave_Writer>, QString> make(
-        uint32_t sample_rate, QString const& path
+        uint32_t sample_rate,
+        SampleFormat format,
+        QString const& path,
+        uint64_t expected_nsamp = 0
+    );
+
+    /// Opens a file to write samples starting at offset (in samples), without writing
+    /// a header or truncating the file. Used to write segments of a file in parallel.
+    /// Once all segments are closed, call finish_segments() to write the header.
+    ///
+    /// expected_nsamp must be the same as passed to finish_segments().
+    static Result<std::unique_ptr<Wave_Writer>, QString> make_segment(
+        uint32_t sample_rate, SampleFormat format, QString const& path,
+        uint64_t expected_nsamp, uint64_t offset
+    );
+
+    /// Writes the header of a stereo file written by make_segment(), which holds nsamp
+    /// samples in total.
+    [[nodiscard]] static QString finish_segments(
+        uint32_t sample_rate, SampleFormat format, QString const& path,
+        uint64_t expected_nsamp, uint64_t nsamp
     );
 
     /// Enables stereo output.
     void enable_stereo();
 
-    /// Appends nsamp samples to file.
-    [[nodiscard]] QString write(Amplitude const* in, uint32_t nsamp);
+    /// Queues writes to a background thread (shared by all Wave_Writer) in large
+    /// chunks, so the caller doesn't wait for the disk. Errors are returned by later
+    /// calls to write() or close().
+    void enable_async();
+
+    /// Reserves disk space for nsamp samples, to reduce fragmentation.
+    /// If fewer samples are written, close() truncates the file.
+    [[nodiscard]] QString preallocate(uint64_t nsamp);
+
+    /// Appends nsamp samples to file. in holds little-endian samples in the format
+    /// passed to make().
+    [[nodiscard]] QString write(void const* in, uint32_t nsamp);
+
+    /// Appends a copy of nsamp samples which were already written, starting begin
+    /// samples after the first sample written. On Linux, the kernel copies the data
+    /// (sharing disk blocks on filesystems which support reflinks).
+    [[nodiscard]] QString copy_samples(uint64_t begin, uint64_t nsamp);
 
     /// Number of samples written so far.
-    uint32_t sample_count() const;
+    uint64_t sample_count() const;
 
     /// Finishes writing sound file and closes it. May be called multiple times,
     /// and does nothing on subsequent calls (this function is idempotent).